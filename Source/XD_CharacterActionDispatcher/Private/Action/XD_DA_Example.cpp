@@ -17,15 +17,10 @@ bool UXD_DA_Example::IsActionValid() const
 
 void UXD_DA_Example::WhenActionActived()
 {
-	GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &UXD_DA_Example::WhenTimeFinished, DelayTime);
+	SetActionTimer(DelayTime);
 }
 
-void UXD_DA_Example::WhenActionDeactived()
-{
-	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
-}
-
-void UXD_DA_Example::WhenTimeFinished()
+void UXD_DA_Example::WhenActionTimerFired()
 {
 	ExecuteEventAndFinishAction(OnFinished);
 }
@@ -4,12 +4,17 @@
 #include <GameFramework/Pawn.h>
 #include <AIController.h>
 #include <Navigation/PathFollowingComponent.h>
+#include "Interface/XD_DispatchableEntityInterface.h"
 
 UXD_DA_MoveTo::UXD_DA_MoveTo()
+	:bIsEntityMoveRequest(false)
 {
 #if WITH_EDITORONLY_DATA
 	bIsPluginAction = true;
 #endif
+	OccupiedChannels = (uint8)EDispatchableActionChannel::Locomotion;
+	// 默认只报告，需要自动恢复的项目在子类中改为Recover
+	WatchdogDuration = 60.f;
 }
 
 TSet<AActor*> UXD_DA_MoveTo::GetAllRegistableEntities() const
@@ -50,20 +55,67 @@ void UXD_DA_MoveTo::WhenActionActived()
 			break;
 		}
 	}
+	else if (Mover->Implements<UXD_DispatchableEntityInterface>() && IXD_DispatchableEntityInterface::AD_RequestMoveTo(Mover, this, Location, Goal.Get()))
+	{
+		// 请求中可能已调用FinishMoveRequest
+		bIsEntityMoveRequest = State == EDispatchableActionState::Active;
+	}
+	else
+	{
+		ExecuteEventAndFinishAction(WhenCanNotReached);
+	}
 }
 
 void UXD_DA_MoveTo::WhenActionDeactived()
+{
+	StopMove(Pawn.Get());
+}
+
+void UXD_DA_MoveTo::WhenActionFinished()
 {
 	APawn* Mover = Pawn.Get();
-	if (AAIController* AIController = Cast<AAIController>(Mover->GetController()))
+}
+
+bool UXD_DA_MoveTo::RecoverStuckAction()
+{
+	APawn* Mover = Pawn.Get();
+	if (AAIController* AIController = Mover ? Cast<AAIController>(Mover->GetController()) : nullptr)
 	{
-		AIController->StopMovement();
+		// 先解绑，避免停止移动时的Aborted回调
+		AIController->GetPathFollowingComponent()->OnRequestFinished.RemoveAll(this);
 	}
+	StopMove(Mover);
+	ExecuteEventAndFinishAction(WhenCanNotReached);
+	return true;
 }
 
-void UXD_DA_MoveTo::WhenActionFinished()
+void UXD_DA_MoveTo::FinishMoveRequest(bool bSucceeded)
 {
-	APawn* Mover = Pawn.Get();
+	if (State != EDispatchableActionState::Active)
+	{
+		return;
+	}
+
+	bIsEntityMoveRequest = false;
+	ExecuteEventAndFinishAction(bSucceeded ? WhenReached : WhenCanNotReached);
+}
+
+void UXD_DA_MoveTo::StopMove(APawn* Mover)
+{
+	if (Mover == nullptr)
+	{
+		return;
+	}
+
+	if (AAIController* AIController = Cast<AAIController>(Mover->GetController()))
+	{
+		AIController->StopMovement();
+	}
+	else if (bIsEntityMoveRequest)
+	{
+		bIsEntityMoveRequest = false;
+		IXD_DispatchableEntityInterface::AD_StopMove(Mover, this);
+	}
 }
 
 void UXD_DA_MoveTo::WhenRequestFinished(FAIRequestID RequestID, const FPathFollowingResult& Result)
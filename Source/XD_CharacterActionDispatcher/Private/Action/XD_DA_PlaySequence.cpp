@@ -12,6 +12,10 @@ UXD_DA_PlaySequenceBase::UXD_DA_PlaySequenceBase()
 	bIsPluginAction = true;
 	bShowInExecuteActionNode = false;
 #endif
+	// 定序器会移动绑定的实体、播放动画并切换镜头
+	OccupiedChannels = (uint8)(EDispatchableActionChannel::Locomotion | EDispatchableActionChannel::Animation | EDispatchableActionChannel::Camera);
+	// 默认只报告，需要自动恢复的项目在子类中改为Recover
+	WatchdogDuration = 120.f;
 }
 
 TSet<AActor*> UXD_DA_PlaySequenceBase::GetAllRegistableEntities() const
@@ -28,6 +32,16 @@ TSet<AActor*> UXD_DA_PlaySequenceBase::GetAllRegistableEntities() const
 	return Entities;
 }
 
+void UXD_DA_PlaySequenceBase::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::Exclusive)
+	{
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(PlaySequenceActorDatas.GetAllocatedSize() + PlaySequenceMoveToDatas.GetAllocatedSize());
+	}
+}
+
 bool UXD_DA_PlaySequenceBase::IsActionValid() const
 {
 	for (const FPlaySequenceActorData& Data : PlaySequenceActorDatas)
@@ -79,6 +93,27 @@ void UXD_DA_PlaySequenceBase::WhenActionFinished()
 
 }
 
+bool UXD_DA_PlaySequenceBase::RecoverStuckAction()
+{
+	// 只恢复卡在移动阶段的行为，Sequence播放中时保持执行
+	if (!PlaySequenceMoveToDatas.ContainsByPredicate([](const FPlaySequenceMoveToData& E) {return E.bIsReached == false; }))
+	{
+		return false;
+	}
+
+	for (const FPlaySequenceMoveToData& Data : PlaySequenceMoveToDatas)
+	{
+		APawn* Mover = Data.PawnRef.Get();
+		if (AAIController* AIController = Mover ? Cast<AAIController>(Mover->GetController()) : nullptr)
+		{
+			AIController->GetPathFollowingComponent()->OnRequestFinished.RemoveAll(this);
+			AIController->StopMovement();
+		}
+	}
+	ExecuteEventAndFinishAction(WhenCanNotPlay);
+	return true;
+}
+
 void UXD_DA_PlaySequenceBase::WhenSequencerPlayFinished()
 {
 	SequencePlayer->SequencePlayer->OnStop.RemoveDynamic(this, &UXD_DA_PlaySequenceBase::WhenSequencerPlayFinished);
@@ -16,6 +16,8 @@ UXD_DA_RoleSelectionBase::UXD_DA_RoleSelectionBase()
 	bShowInExecuteActionNode = false;
 	bIsPluginAction = true;
 #endif
+	// 显示选项时角色仍可移动与播放动画
+	OccupiedChannels = (uint8)(EDispatchableActionChannel::Dialogue | EDispatchableActionChannel::Interaction);
 }
 
 TSet<AActor*> UXD_DA_RoleSelectionBase::GetAllRegistableEntities() const
@@ -23,6 +25,16 @@ TSet<AActor*> UXD_DA_RoleSelectionBase::GetAllRegistableEntities() const
 	return { Role.Get() };
 }
 
+void UXD_DA_RoleSelectionBase::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::Exclusive)
+	{
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Selections.GetAllocatedSize());
+	}
+}
+
 bool UXD_DA_RoleSelectionBase::IsActionValid() const
 {
 	return Role.IsValid();
@@ -88,7 +100,7 @@ void UXD_DA_RoleSelectionBase::ExecuteRoleSelected(APawn* InRole, const FDA_Disp
 	}
 }
 
-void UXD_DA_RoleSelectionBase::ShowSelection(UXD_ActionDispatcherBase* ActionDispatcher, bool SaveAction, FGuid ActionGuid, const TArray<FDA_RoleSelection>& InSelections, const TArray<bool>& ShowSelectionConditions)
+void UXD_DA_RoleSelectionBase::ShowSelection(UXD_ActionDispatcherBase* ActionDispatcher, bool SaveAction, int32 ActionIndex, const TArray<FDA_RoleSelection>& InSelections, const TArray<bool>& ShowSelectionConditions)
 {
 	for (int32 Idx = 0; Idx < InSelections.Num(); ++Idx)
 	{
@@ -97,7 +109,7 @@ void UXD_DA_RoleSelectionBase::ShowSelection(UXD_ActionDispatcherBase* ActionDis
 			Selections.Add(InSelections[Idx]);
 		}
 	}
-	ActionDispatcher->InvokeActiveAction(this, SaveAction, ActionGuid);
+	ActionDispatcher->InvokeActiveAction(this, SaveAction, ActionIndex);
 }
 
 FDA_RoleSelection& UXD_DA_RoleSelectionBase::SetWhenSelectedEvent(FDA_RoleSelection Selection, const FOnDispatchableActionFinishedEvent& Event)
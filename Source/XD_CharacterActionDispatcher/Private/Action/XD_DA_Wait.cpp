@@ -0,0 +1,29 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Action/XD_DA_Wait.h"
+
+UXD_DA_Wait::UXD_DA_Wait()
+	:Duration(1.f)
+{
+	// 不占用实体
+	OccupiedChannels = (uint8)EDispatchableActionChannel::None;
+}
+
+void UXD_DA_Wait::WhenActionActived()
+{
+	SetActionTimer(Duration);
+}
+
+void UXD_DA_Wait::WhenActionReactived()
+{
+	// 剩余的等待时间已由基类恢复
+	if (!IsActionTimerActive())
+	{
+		SetActionTimer(Duration);
+	}
+}
+
+void UXD_DA_Wait::WhenActionTimerFired()
+{
+	ExecuteEventAndFinishAction(OnWaitFinished);
+}
@@ -7,9 +7,17 @@
 #include "Dispatcher/XD_ActionDispatcherBase.h"
 #include "Interface/XD_DispatchableEntityInterface.h"
 #include "Utils/XD_ActionDispatcher_Log.h"
+#include "Manager/XD_ActionDispatcherManager.h"
+#include "Settings/XD_ActionDispatcherSettings.h"
+#include "Utils/XD_ActionDispatcher_Stats.h"
 
 UXD_DispatchableActionBase::UXD_DispatchableActionBase()
+	:OccupiedChannels((uint8)EDispatchableActionChannel::All), TimeoutSeconds(0.f), WatchdogDuration(0.f), WatchdogPolicy(EDispatchableActionWatchdogPolicy::ReportOnly), WatchdogReportNum(0)
 {
+	for (float& RemainingTime : TimerRemainingTimes)
+	{
+		RemainingTime = 0.f;
+	}
 #if WITH_EDITORONLY_DATA
 	bIsPluginAction = false;
 	bShowInExecuteActionNode = true;
@@ -27,7 +35,7 @@ UWorld* UXD_DispatchableActionBase::GetWorld() const
 	return GetOwner() ? GetOwner()->GetWorld() : nullptr;
 }
 
-void UXD_DispatchableActionBase::ActiveAction()
+bool UXD_DispatchableActionBase::ActiveAction()
 {
 #if WITH_EDITOR
 	// 编辑器下修复SoftObject运行时的指向
@@ -46,9 +54,22 @@ void UXD_DispatchableActionBase::ActiveAction()
 	check(State != EDispatchableActionState::Active);
 	ActionDispatcher_Display_VLog(GetOwner(), "激活%s中的行为%s", *UXD_DebugFunctionLibrary::GetDebugName(GetOwner()), *UXD_DebugFunctionLibrary::GetDebugName(GetClass()));
 	State = EDispatchableActionState::Active;
-	for (AActor* Entity : GetAllRegistableEntities())
+	if (RegisterAllEntities() == false)
+	{
+		State = EDispatchableActionState::Deactive;
+		return false;
+	}
+	if (TimeoutSeconds > 0.f)
+	{
+		TimerRemainingTimes[(int32)EDispatchableActionTimerType::Timeout] = TimeoutSeconds;
+		ScheduleTimer(EDispatchableActionTimerType::Timeout, TimeoutSeconds);
+	}
+	// 重复使用的行为重新开始计算报告次数
+	WatchdogReportNum = 0;
+	if (WatchdogDuration > 0.f && GetDefault<UXD_ActionDispatcherSettings>()->bEnableActionWatchdog)
 	{
-		RegisterEntity(Entity);
+		TimerRemainingTimes[(int32)EDispatchableActionTimerType::Watchdog] = WatchdogDuration;
+		ScheduleTimer(EDispatchableActionTimerType::Watchdog, WatchdogDuration);
 	}
 	WhenActionActived();
 	OnActionActived.ExecuteIfBound();
@@ -58,6 +79,7 @@ void UXD_DispatchableActionBase::ActiveAction()
 	{
 		DeactiveAction();
 	}
+	return true;
 }
 
 void UXD_DispatchableActionBase::AbortAction()
@@ -91,6 +113,7 @@ void UXD_DispatchableActionBase::DeactiveAction()
 	}
 
 	SaveState();
+	CancelTimers();
 
 	for (AActor* Entity : GetAllRegistableEntities())
 	{
@@ -101,17 +124,27 @@ void UXD_DispatchableActionBase::DeactiveAction()
 	OnActionDeactived.ExecuteIfBound();
 }
 
-void UXD_DispatchableActionBase::ReactiveAction()
+bool UXD_DispatchableActionBase::ReactiveAction()
 {
 	check(State != EDispatchableActionState::Active);
 
 	ActionDispatcher_Display_VLog(GetOwner(), "再次激活%s中的行为%s", *UXD_DebugFunctionLibrary::GetDebugName(GetOwner()), *UXD_DebugFunctionLibrary::GetDebugName(GetClass()));
 	State = EDispatchableActionState::Active;
-	for (AActor* Entity : GetAllRegistableEntities())
+	if (RegisterAllEntities() == false)
 	{
-		RegisterEntity(Entity);
+		State = EDispatchableActionState::Deactive;
+		return false;
+	}
+	// 恢复反激活或存档时剩余的定时
+	for (int32 Idx = 0; Idx < ActionTimerTypeNum; ++Idx)
+	{
+		if (TimerRemainingTimes[Idx] > 0.f)
+		{
+			ScheduleTimer((EDispatchableActionTimerType)Idx, TimerRemainingTimes[Idx]);
+		}
 	}
 	WhenActionReactived();
+	return true;
 }
 
 void UXD_DispatchableActionBase::WhenActionReactived()
@@ -128,6 +161,12 @@ void UXD_DispatchableActionBase::FinishAction()
 	UXD_ActionDispatcherBase* ActionDispatcher = GetOwner();
 	ActionDispatcher->CurrentActions.Remove(this);
 
+	CancelTimers();
+	for (float& RemainingTime : TimerRemainingTimes)
+	{
+		RemainingTime = 0.f;
+	}
+
 	for (AActor* Entity : GetAllRegistableEntities())
 	{
 		UnregisterEntity(Entity);
@@ -142,9 +181,145 @@ void UXD_DispatchableActionBase::FinishAction()
 
 void UXD_DispatchableActionBase::SaveState()
 {
+	SaveTimerRemainingTime();
 	WhenSaveState();
 }
 
+void UXD_DispatchableActionBase::WhenActionTimeout()
+{
+	ActionDispatcher_Warning_LOG("%s中的行为%s超时", *UXD_DebugFunctionLibrary::GetDebugName(GetOwner()), *UXD_DebugFunctionLibrary::GetDebugName(GetClass()));
+	AbortDispatcher();
+}
+
+void UXD_DispatchableActionBase::SetActionTimer(float Delay)
+{
+	const float ClampedDelay = FMath::Max(Delay, KINDA_SMALL_NUMBER);
+	TimerRemainingTimes[(int32)EDispatchableActionTimerType::Action] = ClampedDelay;
+	if (State == EDispatchableActionState::Active)
+	{
+		ScheduleTimer(EDispatchableActionTimerType::Action, ClampedDelay);
+	}
+}
+
+void UXD_DispatchableActionBase::ClearActionTimer()
+{
+	FActionTimerHandle& Handle = TimerHandles[(int32)EDispatchableActionTimerType::Action];
+	TimerRemainingTimes[(int32)EDispatchableActionTimerType::Action] = 0.f;
+	if (Handle.IsValid())
+	{
+		UXD_ActionDispatcherManager::Get(this)->ActionTimerWheel.Cancel(Handle);
+	}
+}
+
+bool UXD_DispatchableActionBase::IsActionTimerActive() const
+{
+	const FActionTimerHandle& Handle = TimerHandles[(int32)EDispatchableActionTimerType::Action];
+	return Handle.IsValid() && UXD_ActionDispatcherManager::Get(this)->ActionTimerWheel.IsActive(Handle);
+}
+
+void UXD_DispatchableActionBase::WhenTimerFired(EDispatchableActionTimerType Type)
+{
+	// 定时器已到期，先清除记录，否则再次激活时会重新计时完整的时长
+	TimerHandles[(int32)Type].Invalidate();
+	TimerRemainingTimes[(int32)Type] = 0.f;
+	// 未激活时到期的定时器直接作废，再次激活后不补发
+	if (State != EDispatchableActionState::Active)
+	{
+		return;
+	}
+
+	switch (Type)
+	{
+	case EDispatchableActionTimerType::Timeout:
+		WhenActionTimeout();
+		break;
+	case EDispatchableActionTimerType::Action:
+		WhenActionTimerFired();
+		break;
+	case EDispatchableActionTimerType::Watchdog:
+		WhenWatchdogFired();
+		break;
+	}
+}
+
+void UXD_DispatchableActionBase::WhenWatchdogFired()
+{
+	WatchdogReportNum += 1;
+	INC_DWORD_STAT(STAT_ActionDispatcher_WatchdogStuck);
+	ActionDispatcher_Warning_LOG("%s中的行为%s执行超过%.1f秒，可能已卡住", *UXD_DebugFunctionLibrary::GetDebugName(GetOwner()), *UXD_DebugFunctionLibrary::GetDebugName(GetClass()), WatchdogDuration * WatchdogReportNum);
+
+	switch (WatchdogPolicy)
+	{
+	case EDispatchableActionWatchdogPolicy::Recover:
+		if (RecoverStuckAction())
+		{
+			INC_DWORD_STAT(STAT_ActionDispatcher_WatchdogRecovered);
+			return;
+		}
+		break;
+	case EDispatchableActionWatchdogPolicy::Abort:
+		INC_DWORD_STAT(STAT_ActionDispatcher_WatchdogAborted);
+		AbortDispatcher();
+		return;
+	default:
+		break;
+	}
+
+	// 未处理时继续计时，之后再次报告
+	if (State == EDispatchableActionState::Active)
+	{
+		TimerRemainingTimes[(int32)EDispatchableActionTimerType::Watchdog] = WatchdogDuration;
+		ScheduleTimer(EDispatchableActionTimerType::Watchdog, WatchdogDuration);
+	}
+}
+
+void UXD_DispatchableActionBase::ScheduleTimer(EDispatchableActionTimerType Type, float Delay)
+{
+	FActionTimerWheel& TimerWheel = UXD_ActionDispatcherManager::Get(this)->ActionTimerWheel;
+	FActionTimerHandle& Handle = TimerHandles[(int32)Type];
+	TimerWheel.Cancel(Handle);
+	Handle = TimerWheel.Schedule(this, Type, Delay);
+}
+
+bool UXD_DispatchableActionBase::HasAnyTimer() const
+{
+	for (const FActionTimerHandle& Handle : TimerHandles)
+	{
+		if (Handle.IsValid())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UXD_DispatchableActionBase::SaveTimerRemainingTime()
+{
+	if (HasAnyTimer())
+	{
+		const FActionTimerWheel& TimerWheel = UXD_ActionDispatcherManager::Get(this)->ActionTimerWheel;
+		for (int32 Idx = 0; Idx < ActionTimerTypeNum; ++Idx)
+		{
+			if (TimerWheel.IsActive(TimerHandles[Idx]))
+			{
+				TimerRemainingTimes[Idx] = TimerWheel.GetRemainingTime(TimerHandles[Idx]);
+			}
+		}
+	}
+}
+
+void UXD_DispatchableActionBase::CancelTimers()
+{
+	if (HasAnyTimer())
+	{
+		FActionTimerWheel& TimerWheel = UXD_ActionDispatcherManager::Get(this)->ActionTimerWheel;
+		for (FActionTimerHandle& Handle : TimerHandles)
+		{
+			TimerWheel.Cancel(Handle);
+		}
+	}
+}
+
 UXD_ActionDispatcherBase* UXD_DispatchableActionBase::GetOwner() const
 {
 	return CastChecked<UXD_ActionDispatcherBase>(GetOuter());
@@ -166,22 +341,83 @@ TSet<AActor*> UXD_DispatchableActionBase::GetAllRegistableEntities() const
 	return {};
 }
 
-void UXD_DispatchableActionBase::RegisterEntity(AActor* Actor)
+UXD_ActionDispatcherBase* UXD_DispatchableActionBase::FindBlockingDispatcher() const
+{
+	UXD_ActionDispatcherBase* SelfDispatcher = GetOwner();
+	// 被领导的调度器由领导者控制，不参与抢占
+	if (SelfDispatcher->ActionDispatcherLeader)
+	{
+		return nullptr;
+	}
+
+	for (AActor* Entity : GetAllRegistableEntities())
+	{
+		if (Entity && Entity->Implements<UXD_DispatchableEntityInterface>())
+		{
+			for (UXD_DispatchableActionBase* PreAction : IXD_DispatchableEntityInterface::GetCurrentDispatchableActions(Entity))
+			{
+				UXD_ActionDispatcherBase* PreDispatcher = PreAction->GetOwner();
+				if (PreDispatcher != SelfDispatcher && PreDispatcher->State == EActionDispatcherState::Active)
+				{
+					if (IsCompatibleWith(PreAction) == false && SelfDispatcher->CanPreempt(PreDispatcher) == false)
+					{
+						return PreDispatcher;
+					}
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool UXD_DispatchableActionBase::RegisterAllEntities()
+{
+	TArray<AActor*, TInlineAllocator<4>> RegisteredEntities;
+	for (AActor* Entity : GetAllRegistableEntities())
+	{
+		if (RegisterEntity(Entity) == false)
+		{
+			for (AActor* RegisteredEntity : RegisteredEntities)
+			{
+				UnregisterEntity(RegisteredEntity);
+			}
+			return false;
+		}
+		RegisteredEntities.Add(Entity);
+	}
+	return true;
+}
+
+bool UXD_DispatchableActionBase::RegisterEntity(AActor* Actor)
 {
 	check((Actor->GetWorld()->AreActorsInitialized()));
 
 	if (Actor && Actor->Implements<UXD_DispatchableEntityInterface>())
 	{
 		TArray<UXD_DispatchableActionBase*>& Actions = IXD_DispatchableEntityInterface::GetCurrentDispatchableActions(Actor);
+		UXD_ActionDispatcherBase* SelfDispatcher = GetOwner();
+		// 先检查是否会被拒绝，避免中断了部分调度器后才发现无法注册
+		if (SelfDispatcher->ActionDispatcherLeader == nullptr)
+		{
+			for (UXD_DispatchableActionBase* PreAction : Actions)
+			{
+				UXD_ActionDispatcherBase* PreDispatcher = PreAction->GetOwner();
+				if (PreDispatcher != SelfDispatcher && PreDispatcher->State == EActionDispatcherState::Active && IsCompatibleWith(PreAction) == false && SelfDispatcher->CanPreempt(PreDispatcher) == false)
+				{
+					ActionDispatcher_Warning_LOG("%s无法抢占%s中的实体%s", *UXD_DebugFunctionLibrary::GetDebugName(SelfDispatcher), *UXD_DebugFunctionLibrary::GetDebugName(PreDispatcher), *UXD_DebugFunctionLibrary::GetDebugName(Actor));
+					return false;
+				}
+			}
+		}
+
 		for (UXD_DispatchableActionBase* PreAction : TArray<UXD_DispatchableActionBase*>(Actions))
 		{
 			check(PreAction != this);
 
 			//调度器内的行为抢占式跳转移除前一个进行时节点
-			UXD_ActionDispatcherBase* SelfDispatcher = GetOwner();
 			UXD_ActionDispatcherBase* PreDispatcher = PreAction->GetOwner();
 
-			const bool IsBothCompatible = SelfDispatcher->ActionIsBothCompatible(this, PreAction);
+			const bool IsBothCompatible = IsCompatibleWith(PreAction);
 			if (!IsBothCompatible)
 			{
 				if (PreDispatcher == SelfDispatcher)
@@ -199,8 +435,8 @@ void UXD_DispatchableActionBase::RegisterEntity(AActor* Actor)
 					{
 						if (PreDispatcher->State == EActionDispatcherState::Active)
 						{
-						 	//非同一调度器先将另一个调度器中断
-						 	PreDispatcher->AbortDispatch(PreAction);
+							//非同一调度器先将另一个调度器中断
+							PreDispatcher->AbortDispatch(PreAction);
 						}
 					}
 				}
@@ -209,6 +445,7 @@ void UXD_DispatchableActionBase::RegisterEntity(AActor* Actor)
 		Actions.Add(this);
 	}
 	ActionDispatcher_Display_VLog(Actor, "%s执行行为%s", *UXD_DebugFunctionLibrary::GetDebugName(Actor), *UXD_DebugFunctionLibrary::GetDebugName(GetClass()));
+	return true;
 }
 
 void UXD_DispatchableActionBase::UnregisterEntity(AActor* Actor)
@@ -15,4 +15,20 @@ void UActionDispatcherBlueprint::GetReparentingRules(TSet<const UClass*>& Allowe
 {
 	AllowedChildrenOfClasses.Add(UXD_ActionDispatcherBase::StaticClass());
 }
+
+void UActionDispatcherBlueprint::GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const
+{
+	Super::GetAssetRegistryTags(OutTags);
+
+	FString FinishTagsValue;
+	for (const FName& FinishTag : FinishTags)
+	{
+		if (FinishTagsValue.Len() > 0)
+		{
+			FinishTagsValue += TEXT(",");
+		}
+		FinishTagsValue += FinishTag.ToString();
+	}
+	OutTags.Add(FAssetRegistryTag(GetFinishTagsRegistryName(), FinishTagsValue, FAssetRegistryTag::TT_Hidden));
+}
 #endif
\ No newline at end of file
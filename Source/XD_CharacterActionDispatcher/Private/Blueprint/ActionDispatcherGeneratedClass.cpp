@@ -1,3 +1,31 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Blueprint/ActionDispatcherGeneratedClass.h"
+
+const FActionDispatcherNodeData* UActionDispatcherGeneratedClass::FindNodeData(const FGuid& NodeGuid, EActionDispatcherNodeType NodeType) const
+{
+	for (const UClass* Class = this; Class; Class = Class->GetSuperClass())
+	{
+		if (const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Class))
+		{
+			if (const FActionDispatcherNodeData* NodeData = GeneratedClass->NodeDatas.FindByPredicate([&](const FActionDispatcherNodeData& E) {return E.NodeType == NodeType && E.NodeGuid == NodeGuid; }))
+			{
+				return NodeData;
+			}
+		}
+	}
+	return nullptr;
+}
+
+const UActionDispatcherGeneratedClass* UActionDispatcherGeneratedClass::FindParentCompiledClass(const UClass* Class)
+{
+	for (; Class; Class = Class->GetSuperClass())
+	{
+		const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Class);
+		if (GeneratedClass && GeneratedClass->HasCompiledData())
+		{
+			return GeneratedClass;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,168 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Components/XD_DA_StateTagComponent.h"
+
+namespace StateTagBits
+{
+	TMap<FGameplayTag, int32> TagBitIndices;
+	// Tag自身与所有父Tag的序号
+	TMap<FGameplayTag, TArray<int32>> TagWithParentBitIndices;
+
+	const TArray<int32>& GetTagWithParentBitIndices(const FGameplayTag& Tag)
+	{
+		if (const TArray<int32>* BitIndices = TagWithParentBitIndices.Find(Tag))
+		{
+			return *BitIndices;
+		}
+
+		TArray<int32> BitIndices;
+		for (const FGameplayTag& ParentTag : Tag.GetGameplayTagParents())
+		{
+			BitIndices.AddUnique(UXD_DA_StateTagComponent::GetTagBitIndex(ParentTag));
+		}
+		return TagWithParentBitIndices.Add(Tag, MoveTemp(BitIndices));
+	}
+
+	void SetBits(TBitArray<>& Bits, const FGameplayTag& Tag)
+	{
+		for (const int32 BitIndex : GetTagWithParentBitIndices(Tag))
+		{
+			if (BitIndex >= Bits.Num())
+			{
+				Bits.Add(false, BitIndex + 1 - Bits.Num());
+			}
+			Bits[BitIndex] = true;
+		}
+	}
+
+	bool HasBit(const TBitArray<>& Bits, int32 BitIndex)
+	{
+		return BitIndex < Bits.Num() && Bits[BitIndex];
+	}
+
+	void CompileExpr(const FGameplayTagQueryExpression& Expr, FXD_DA_StateTagQuery& Query)
+	{
+		Query.Program.Add(Expr.ExprType);
+		if (Expr.UsesTagSet())
+		{
+			Query.Program.Add(Expr.TagSet.Num());
+			for (const FGameplayTag& Tag : Expr.TagSet)
+			{
+				Query.Program.Add(Query.Tags.AddUnique(Tag));
+			}
+		}
+		else
+		{
+			Query.Program.Add(Expr.ExprSet.Num());
+			for (const FGameplayTagQueryExpression& SubExpr : Expr.ExprSet)
+			{
+				CompileExpr(SubExpr, Query);
+			}
+		}
+	}
+}
+
+FXD_DA_StateTagQuery FXD_DA_StateTagQuery::Compile(const FGameplayTagQuery& Query)
+{
+	FXD_DA_StateTagQuery CompiledQuery;
+	if (!Query.IsEmpty())
+	{
+		FGameplayTagQueryExpression Expr;
+		Query.GetQueryExpr(Expr);
+		StateTagBits::CompileExpr(Expr, CompiledQuery);
+	}
+	return CompiledQuery;
+}
+
+bool FXD_DA_StateTagQuery::Matches(const TBitArray<>& StateBits) const
+{
+	if (TagBitIndices.Num() != Tags.Num())
+	{
+		TagBitIndices.Reset(Tags.Num());
+		for (const FGameplayTag& Tag : Tags)
+		{
+			TagBitIndices.Add(UXD_DA_StateTagComponent::GetTagBitIndex(Tag));
+		}
+	}
+	return Evaluate([&](int32 TagIdx) { return StateTagBits::HasBit(StateBits, TagBitIndices[TagIdx]); });
+}
+
+UXD_DA_StateTagComponent::UXD_DA_StateTagComponent()
+	:bStateBitsDirty(true)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UXD_DA_StateTagComponent::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	// 读档后根据StateTags重建状态位
+	if (Ar.IsLoading())
+	{
+		bStateBitsDirty = true;
+	}
+}
+
+#if WITH_EDITOR
+void UXD_DA_StateTagComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	bStateBitsDirty = true;
+}
+#endif
+
+bool UXD_DA_StateTagComponent::HasStateTag(const FGameplayTag& Tag) const
+{
+	return Tag.IsValid() && StateTagBits::HasBit(GetStateBits(), GetTagBitIndex(Tag));
+}
+
+void UXD_DA_StateTagComponent::AddStateTag(const FGameplayTag& Tag)
+{
+	if (Tag.IsValid())
+	{
+		StateTags.AddTag(Tag);
+		if (!bStateBitsDirty)
+		{
+			StateTagBits::SetBits(StateBits, Tag);
+		}
+	}
+}
+
+void UXD_DA_StateTagComponent::RemoveStateTag(const FGameplayTag& Tag)
+{
+	// 父Tag可能被其它Tag共享，移除时重建
+	if (StateTags.RemoveTag(Tag))
+	{
+		bStateBitsDirty = true;
+	}
+}
+
+bool UXD_DA_StateTagComponent::MatchesStateTagQuery(const FXD_DA_StateTagQuery& Query) const
+{
+	return Query.Matches(GetStateBits());
+}
+
+int32 UXD_DA_StateTagComponent::GetTagBitIndex(const FGameplayTag& Tag)
+{
+	check(IsInGameThread());
+	if (const int32* BitIndex = StateTagBits::TagBitIndices.Find(Tag))
+	{
+		return *BitIndex;
+	}
+	return StateTagBits::TagBitIndices.Add(Tag, StateTagBits::TagBitIndices.Num());
+}
+
+const TBitArray<>& UXD_DA_StateTagComponent::GetStateBits() const
+{
+	if (bStateBitsDirty)
+	{
+		bStateBitsDirty = false;
+		StateBits.Empty();
+		for (const FGameplayTag& Tag : StateTags)
+		{
+			StateTagBits::SetBits(StateBits, Tag);
+		}
+	}
+	return StateBits;
+}
@@ -14,9 +14,26 @@
 #include "XD_DebugFunctionLibrary.h"
 #include "Interface/XD_DispatchableEntityInterface.h"
 #include "XD_SaveGameSystemBase.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
+#include "Utils/XD_ActionDispatcher_Stats.h"
+
+void UXD_ActionDispatcherExtraState::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::Exclusive)
+	{
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(ActivedTogetherControl.GetAllocatedSize() + SubActionDispatcherSlots.GetAllocatedSize());
+	}
+}
 
 UXD_ActionDispatcherBase::UXD_ActionDispatcherBase()
-	:bIsMainDispatcher(true)
+	:bGameThreadOnlyCanStart(false),
+	bIsMainDispatcher(true),
+	Priority(0),
+	PreemptPolicy(EActionDispatcherPreemptPolicy::PreemptLower),
+	bLeaseEntities(false),
+	LeaseDuration(0.f)
 {
 
 }
@@ -31,6 +48,54 @@ bool UXD_ActionDispatcherBase::ReceiveCanStartDispatcher_Implementation() const
 	return true;
 }
 
+bool UXD_ActionDispatcherBase::CanStartDispatcher_AnyThread(const FActionDispatcherStartSnapshot& Snapshot) const
+{
+	if (Snapshot.bLeaderValid == false)
+	{
+		return false;
+	}
+	for (int32 Idx = 0; Idx < Snapshot.SoftReferences.Num(); ++Idx)
+	{
+		if (Snapshot.SoftReferences[Idx] == nullptr)
+		{
+			return false;
+		}
+		// 与IsAllSoftReferenceValid的抢占规则一致，优先级与抢占策略只在类默认值中配置
+		const UXD_ActionDispatcherBase* MainDispatcher = Snapshot.MainDispatchers[Idx];
+		if (MainDispatcher && MainDispatcher != this && Snapshot.bBeLeading == false && CanPreempt(MainDispatcher) == false)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UXD_ActionDispatcherBase::MakeStartSnapshot(FActionDispatcherStartSnapshot& OutSnapshot, TArray<UObject*>& OutSoftReferences, TArray<const UXD_ActionDispatcherBase*>& OutMainDispatchers) const
+{
+	check(IsInGameThread());
+
+	OutSnapshot.Dispatcher = this;
+	OutSnapshot.bGameThreadOnly = bGameThreadOnlyCanStart;
+	OutSnapshot.bBeLeading = ActionDispatcherLeader != nullptr;
+	OutSnapshot.bLeaderValid = DispatcherLeader.IsNull() || DispatcherLeader.IsValid();
+	OutSnapshot.SoftReferenceStart = OutSoftReferences.Num();
+	if (bGameThreadOnlyCanStart)
+	{
+		return;
+	}
+
+	UpdateSoftReferenceCache();
+	const TBitArray<>& EntityFlags = GetEntityPropertyFlags();
+	for (int32 Idx = 0; Idx < ResolvedSoftReferences.Num(); ++Idx)
+	{
+		UObject* Obj = GetResolvedSoftReference(Idx);
+		OutSoftReferences.Add(Obj);
+		// 实体接口可能由蓝图实现，只能在游戏线程中读取
+		const bool bReadMainDispatcher = Obj && EntityFlags[Idx] && Obj->Implements<UXD_DispatchableEntityInterface>();
+		OutMainDispatchers.Add(bReadMainDispatcher ? IXD_DispatchableEntityInterface::GetCurrentMainDispatcher(Obj) : nullptr);
+	}
+}
+
 bool UXD_ActionDispatcherBase::IsDispatcherValid() const
 {
 	check(IsSubActionDispatcher() == false);
@@ -65,6 +130,7 @@ void UXD_ActionDispatcherBase::StartDispatch()
 				*SoftObjectPtr = SoftObjectPath.ResolveObject();
 			}
 		}
+		InvalidateSoftReferenceCache();
 #endif
 
 		State = EActionDispatcherState::Active;
@@ -99,29 +165,81 @@ UXD_DispatchableActionBase* UXD_ActionDispatcherBase::CreateAction(TSubclassOf<U
 	return NewObject<UXD_DispatchableActionBase>(Outer, ObjectClass);
 }
 
-void UXD_ActionDispatcherBase::InvokeActiveAction(UXD_DispatchableActionBase* Action, bool SaveAction, FGuid ActionGuid)
+namespace ActionDispatcherSlot
 {
-	check(Action && !CurrentActions.Contains(Action));
-	check(IsSubActionDispatcher() == false);
+	// SlotNum为该类节点的数量，首次写入时一次分配
+	template<typename T>
+	void SetSlot(TArray<T*>& Slots, int32 Index, T* Value, int32 SlotNum)
+	{
+		check(Index >= 0);
+		if (Slots.Num() <= Index)
+		{
+			Slots.Reserve(FMath::Max(SlotNum, Index + 1));
+			Slots.SetNumZeroed(Index + 1);
+		}
+		Slots[Index] = Value;
+	}
+
+	template<typename T>
+	T* GetSlot(const TArray<T*>& Slots, int32 Index)
+	{
+		return Slots.IsValidIndex(Index) ? Slots[Index] : nullptr;
+	}
+}
 
+void UXD_ActionDispatcherBase::InvokeActiveAction(UXD_DispatchableActionBase* Action, bool SaveAction, int32 ActionIndex)
+{
 	if (SaveAction)
 	{
-		check(ActionGuid.IsValid());
-		SavedActions.FindOrAdd(ActionGuid) = Action;
+		ActionDispatcherSlot::SetSlot(SavedActionSlots, ActionIndex, Action, GetNodeNum(EActionDispatcherNodeType::Action));
 	}
 
+	GetMainActionDispatcher()->ActiveActionImpl(Action);
+}
+
+void UXD_ActionDispatcherBase::ActiveActionImpl(UXD_DispatchableActionBase* Action)
+{
+	check(Action && !CurrentActions.Contains(Action));
+	check(IsSubActionDispatcher() == false);
+
 	if (State == EActionDispatcherState::Active)
 	{
-		if (Action->IsActionValid())
+		UXD_ActionDispatcherBase* BlockingDispatcher = Action->IsActionValid() ? Action->FindBlockingDispatcher() : nullptr;
+		bool IsBlocked = BlockingDispatcher != nullptr;
+		bool IsActived = false;
+		if (Action->IsActionValid() && IsBlocked == false)
 		{
 			CurrentActions.Add(Action);
-			Action->ActiveAction();
+			IsActived = Action->ActiveAction();
+			if (IsActived == false)
+			{
+				// 注册实体时被拒绝，行为未激活
+				CurrentActions.Remove(Action);
+				IsBlocked = true;
+			}
 		}
-		else
+
+		if (IsActived == false)
 		{
+			if (BlockingDispatcher)
+			{
+				ActionDispatcher_Display_Log("%s的实体被%s占用且无法抢占，中断调度器", *UXD_DebugFunctionLibrary::GetDebugName(this), *UXD_DebugFunctionLibrary::GetDebugName(BlockingDispatcher));
+			}
+			else if (IsBlocked)
+			{
+				ActionDispatcher_Display_Log("%s注册实体时被拒绝，中断调度器", *UXD_DebugFunctionLibrary::GetDebugName(this));
+			}
 			//要在AbortDispatch添加当前动作，防止UnregisteEntitry那边检查报错
 			AbortDispatch();
 			CurrentActions.Add(Action);
+
+			if (IsBlocked && PreemptPolicy == EActionDispatcherPreemptPolicy::Reject)
+			{
+				if (UXD_ActionDispatcherManager* Manager = GetManager())
+				{
+					Manager->WhenDispatcherRejected(this);
+				}
+			}
 		}
 	}
 	else
@@ -132,6 +250,15 @@ void UXD_ActionDispatcherBase::InvokeActiveAction(UXD_DispatchableActionBase* Ac
 
 void UXD_ActionDispatcherBase::Tick(float DeltaTime)
 {
+	if (State == EActionDispatcherState::Active)
+	{
+		TickTogetherFlowControl(DeltaTime);
+		if (State == EActionDispatcherState::Deactive)
+		{
+			return;
+		}
+	}
+
 	for (UXD_DispatchableActionBase* Action : CurrentActions)
 	{
 		if (Action->bTickable)
@@ -153,13 +280,16 @@ bool UXD_ActionDispatcherBase::IsTickable() const
 
 void UXD_ActionDispatcherBase::ExecuteAbortedDelegate()
 {
-	OnDispatcherAborted.ExecuteIfBound();
-	OnDispatcherAbortedNative.ExecuteIfBound();
+	if (ExtraState)
+	{
+		ExtraState->OnDispatcherAborted.ExecuteIfBound();
+		ExtraState->OnDispatcherAbortedNative.ExecuteIfBound();
+	}
 }
 
 void UXD_ActionDispatcherBase::AbortDispatch(const FOnDispatcherAborted& Event, UXD_DispatchableActionBase* DeactiveRequestAction)
 {
-	OnDispatcherAborted = Event;
+	GetOrCreateExtraState().OnDispatcherAborted = Event;
 	AbortDispatch(DeactiveRequestAction);
 }
 
@@ -167,6 +297,7 @@ void UXD_ActionDispatcherBase::AbortDispatch(UXD_DispatchableActionBase* Deactiv
 {
 	check(State == EActionDispatcherState::Active);
 
+	INC_DWORD_STAT(STAT_ActionDispatcher_Abort);
 	State = EActionDispatcherState::Aborting;
 
 	for (UXD_DispatchableActionBase* Action : CurrentActions)
@@ -186,7 +317,7 @@ void UXD_ActionDispatcherBase::AbortDispatch(UXD_DispatchableActionBase* Deactiv
 
 void UXD_ActionDispatcherBase::AbortDispatch(const FOnDispatcherAbortedNative& Event, UXD_DispatchableActionBase* DeactiveRequestAction /*= nullptr*/)
 {
-	OnDispatcherAbortedNative = Event;
+	GetOrCreateExtraState().OnDispatcherAbortedNative = Event;
 	AbortDispatch(DeactiveRequestAction);
 }
 
@@ -200,7 +331,7 @@ void UXD_ActionDispatcherBase::BP_AbortDispatch(const FOnDispatcherAborted& Even
 
 void UXD_ActionDispatcherBase::AssignOnDispatcherAbort(const FOnDispatcherAborted& Event)
 {
-	OnDispatcherAborted = Event;
+	GetOrCreateExtraState().OnDispatcherAborted = Event;
 }
 
 void UXD_ActionDispatcherBase::WhenActionAborted()
@@ -227,10 +358,10 @@ void UXD_ActionDispatcherBase::DeactiveDispatcher(bool IsFinsihedCompleted)
 
 	if (bIsMainDispatcher)
 	{
-		for (FSoftObjectProperty* SoftObjectProperty : GetSoftObjectPropertys())
+		const TBitArray<>& EntityFlags = GetEntityPropertyFlags();
+		for (TConstSetBitIterator<> It(EntityFlags); It; ++It)
 		{
-			FSoftObjectPtr SoftObjectPtr = SoftObjectProperty->GetPropertyValue(SoftObjectProperty->ContainerPtrToValuePtr<uint8>(this));
-			UObject* Obj = SoftObjectPtr.Get();
+			UObject* Obj = GetResolvedSoftReference(It.GetIndex());
 			if (Obj && Obj->Implements<UXD_DispatchableEntityInterface>())
 			{
 				if (IXD_DispatchableEntityInterface::GetCurrentMainDispatcher(Obj) == this)
@@ -280,7 +411,7 @@ bool UXD_ActionDispatcherBase::CanReactiveDispatcher() const
 	{
 		for (UXD_DispatchableActionBase* Action : CurrentActions)
 		{
-			if (Action->IsActionValid() == false)
+			if (Action->IsActionValid() == false || Action->FindBlockingDispatcher())
 			{
 				return false;
 			}
@@ -293,18 +424,188 @@ bool UXD_ActionDispatcherBase::CanReactiveDispatcher() const
 	}
 }
 
+const FActionDispatcherClassData& UXD_ActionDispatcherBase::GetClassData() const
+{
+	return *GetClass()->GetDefaultObject<UXD_ActionDispatcherBase>()->ClassData;
+}
+
 const TArray<FSoftObjectProperty*>& UXD_ActionDispatcherBase::GetSoftObjectPropertys() const
 {
-	return GetClass()->GetDefaultObject<UXD_ActionDispatcherBase>()->SoftObjectPropertys;
+	return GetClassData().SoftObjectPropertys;
+}
+
+const TBitArray<>& UXD_ActionDispatcherBase::GetEntityPropertyFlags() const
+{
+	return GetClassData().EntityPropertyFlags;
+}
+
+int32 UXD_ActionDispatcherBase::GetNodeNum(EActionDispatcherNodeType NodeType) const
+{
+	// 直接读取生成类，重新编译后不会与类中的数据不一致
+	const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(GetClass());
+	return GeneratedClass && GeneratedClass->HasCompiledData() ? GeneratedClass->GetNodeNum(NodeType) : 0;
 }
 
 void UXD_ActionDispatcherBase::PostCDOContruct()
 {
 	Super::PostCDOContruct();
+
+	// 优先使用编译时烘焙的实体属性，旧资源与原生类在运行时推导
+	const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(GetClass());
+	const bool UseCompiledData = GeneratedClass && GeneratedClass->HasCompiledData();
+	ClassData = MakeUnique<FActionDispatcherClassData>();
 	for (TFieldIterator<FSoftObjectProperty> It(GetClass(), EFieldIteratorFlags::IncludeSuper); It; ++It)
 	{
-		SoftObjectPropertys.Add(*It);
+		FSoftObjectProperty* SoftObjectProperty = *It;
+		ClassData->SoftObjectPropertys.Add(SoftObjectProperty);
+		ClassData->EntityPropertyFlags.Add(UseCompiledData ? GeneratedClass->EntityPropertyNames.Contains(SoftObjectProperty->GetFName()) : IsEntitySoftObjectProperty(SoftObjectProperty));
+	}
+
+	// 子类未生成状态表时使用父类的状态表
+	for (UClass* Class = GetClass(); Class; Class = Class->GetSuperClass())
+	{
+		const UActionDispatcherGeneratedClass* NativeStateClass = Cast<UActionDispatcherGeneratedClass>(Class);
+		if (NativeStateClass && NativeStateClass->NativeStates.Num() > 0)
+		{
+			ClassData->NativeStateClass = NativeStateClass;
+			break;
+		}
 	}
+	if (ClassData->NativeStateClass)
+	{
+		const TArray<FActionDispatcherNativeState>& NativeStates = ClassData->NativeStateClass->NativeStates;
+		for (int32 StateIndex = 0; StateIndex < NativeStates.Num(); ++StateIndex)
+		{
+			const FActionDispatcherNativeState& NativeState = NativeStates[StateIndex];
+			if (NativeState.NodeGuid.IsValid() && NativeState.TogetherPinIndex == 0)
+			{
+				ClassData->NativeNodeStates.Add(NativeState.NodeGuid, StateIndex);
+			}
+
+			FActionDispatcherClassData::FNativeStateCache& Cache = ClassData->NativeStateCaches.AddDefaulted_GetRef();
+			if (NativeState.Type != EActionDispatcherNativeStateType::ExecuteAction || NativeState.ActionClass == nullptr)
+			{
+				continue;
+			}
+			for (const FActionDispatcherNativeParam& Param : NativeState.Params)
+			{
+				Cache.ParamPropertys.Add(FindFProperty<FProperty>(NativeState.ActionClass, Param.PropertyName));
+				Cache.SourcePropertys.Add(Param.SourceMemberName != NAME_None ? FindFProperty<FProperty>(GetClass(), Param.SourceMemberName) : nullptr);
+			}
+			for (const FActionDispatcherNativeTransition& Transition : NativeState.Transitions)
+			{
+				Cache.EventPropertys.Add(FindFProperty<FStructProperty>(NativeState.ActionClass, Transition.EventName));
+			}
+		}
+	}
+}
+
+bool UXD_ActionDispatcherBase::ActionIsBothCompatible(UXD_DispatchableActionBase* LHS, UXD_DispatchableActionBase* RHS) const
+{
+	return LHS->IsCompatibleWith(RHS);
+}
+
+int32 UXD_ActionDispatcherBase::FindNativeState(const FGuid& NodeGuid, int32 PinIndex) const
+{
+	const FActionDispatcherClassData& Data = GetClassData();
+	if (const int32* P_FirstState = Data.NativeNodeStates.Find(NodeGuid))
+	{
+		const int32 StateIndex = *P_FirstState + PinIndex;
+		const TArray<FActionDispatcherNativeState>& NativeStates = Data.NativeStateClass->NativeStates;
+		if (NativeStates.IsValidIndex(StateIndex) && NativeStates[StateIndex].NodeGuid == NodeGuid && NativeStates[StateIndex].TogetherPinIndex == PinIndex)
+		{
+			return StateIndex;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void UXD_ActionDispatcherBase::GetNativeStateNode(int32 StateIndex, FGuid& OutNodeGuid, int32& OutPinIndex) const
+{
+	const FActionDispatcherClassData& Data = GetClassData();
+	if (Data.NativeStateClass && Data.NativeStateClass->NativeStates.IsValidIndex(StateIndex))
+	{
+		const FActionDispatcherNativeState& NativeState = Data.NativeStateClass->NativeStates[StateIndex];
+		OutNodeGuid = NativeState.NodeGuid;
+		OutPinIndex = NativeState.TogetherPinIndex;
+	}
+}
+
+void UXD_ActionDispatcherBase::EnterNativeState(int32 StateIndex)
+{
+	const FActionDispatcherClassData& Data = GetClassData();
+	if (!ensureMsgf(Data.NativeStateClass && Data.NativeStateClass->NativeStates.IsValidIndex(StateIndex), TEXT("%s中不存在原生状态%d"), *GetName(), StateIndex))
+	{
+		return;
+	}
+
+	const FActionDispatcherNativeState& NativeState = Data.NativeStateClass->NativeStates[StateIndex];
+	switch (NativeState.Type)
+	{
+	case EActionDispatcherNativeStateType::ExecuteAction:
+	{
+		const FActionDispatcherClassData::FNativeStateCache& Cache = Data.NativeStateCaches[StateIndex];
+		UXD_DispatchableActionBase* Action = CreateAction(NativeState.ActionClass, GetMainActionDispatcher());
+		for (int32 Idx = 0; Idx < NativeState.Params.Num(); ++Idx)
+		{
+			FProperty* Property = Cache.ParamPropertys[Idx];
+			if (Property == nullptr)
+			{
+				continue;
+			}
+			void* Value = Property->ContainerPtrToValuePtr<void>(Action);
+			if (FProperty* SourceProperty = Cache.SourcePropertys[Idx])
+			{
+				Property->CopyCompleteValue(Value, SourceProperty->ContainerPtrToValuePtr<void>(this));
+			}
+			else
+			{
+				Property->ImportText(*NativeState.Params[Idx].ValueText, Value, PPF_None, Action);
+			}
+		}
+		for (int32 Idx = 0; Idx < NativeState.Transitions.Num(); ++Idx)
+		{
+			if (FStructProperty* EventProperty = Cache.EventPropertys[Idx])
+			{
+				EventProperty->ContainerPtrToValuePtr<FDispatchableActionEventBase>(Action)->BindNativeState(this, NativeState.Transitions[Idx].TargetState);
+			}
+		}
+		InvokeActiveAction(Action, false, INDEX_NONE);
+		break;
+	}
+	case EActionDispatcherNativeStateType::FinishDispatch:
+		FinishDispatch(NativeState.FinishTag);
+		break;
+	case EActionDispatcherNativeStateType::Together:
+	{
+		const bool bTogetherFinished = EnterTogetherFlowControl(NativeState.TogetherNodeIndex, NativeState.TogetherPinIndex, NativeState.TogetherCount, NativeState.RequiredCount, 0.f, FDispatchableActionEventDelegate());
+		const int32 NextState = bTogetherFinished ? NativeState.TogetherState : NativeState.WaitState;
+		if (NextState != INDEX_NONE)
+		{
+			EnterNativeState(NextState);
+		}
+		break;
+	}
+	}
+}
+
+bool UXD_ActionDispatcherBase::CanPreempt(const UXD_ActionDispatcherBase* Other) const
+{
+	switch (PreemptPolicy)
+	{
+	case EActionDispatcherPreemptPolicy::PreemptLower:
+		return Priority >= Other->Priority;
+	case EActionDispatcherPreemptPolicy::QueueBehind:
+		return Priority > Other->Priority;
+	default:
+		return false;
+	}
+}
+
+bool UXD_ActionDispatcherBase::IsEntitySoftObjectProperty(const FSoftObjectProperty* SoftObjectProperty)
+{
+	const UClass* PropertyClass = SoftObjectProperty->PropertyClass;
+	return PropertyClass && (PropertyClass->IsChildOf<AActor>() || PropertyClass->ImplementsInterface(UXD_DispatchableEntityInterface::StaticClass()));
 }
 
 void UXD_ActionDispatcherBase::WhenPlayerLeaderDestroyed(AActor* Actor, EEndPlayReason::Type EndPlayReason)
@@ -339,14 +640,25 @@ void UXD_ActionDispatcherBase::ReactiveDispatcher()
 {
 	check(State == EActionDispatcherState::Deactive);
 
+	RemapLegacySaveData();
+
+	INC_DWORD_STAT(STAT_ActionDispatcher_Reactive);
 	State = EActionDispatcherState::Active;
 	ActionDispatcher_Display_Log("恢复行为调度器%s", *UXD_DebugFunctionLibrary::GetDebugName(this));
 	ActiveDispatcher();
 	for (UXD_DispatchableActionBase* Action : TArray<UXD_DispatchableActionBase*>(CurrentActions))
 	{
-		if (Action)
+		if (Action && Action->ReactiveAction() == false)
 		{
-			Action->ReactiveAction();
+			// 实体已被无法抢占的调度器占用，中断后由管理器重新等待
+			ActionDispatcher_Display_Log("%s恢复时实体被占用且无法抢占，中断调度器", *UXD_DebugFunctionLibrary::GetDebugName(this));
+			if (State == EActionDispatcherState::Active)
+			{
+				CurrentActions.Remove(Action);
+				AbortDispatch();
+				CurrentActions.Add(Action);
+			}
+			break;
 		}
 	}
 }
@@ -355,10 +667,10 @@ void UXD_ActionDispatcherBase::ActiveDispatcher()
 {
 	if (bIsMainDispatcher)
 	{
-		for (FSoftObjectProperty* SoftObjectProperty : GetSoftObjectPropertys())
+		const TBitArray<>& EntityFlags = GetEntityPropertyFlags();
+		for (TConstSetBitIterator<> It(EntityFlags); It; ++It)
 		{
-			FSoftObjectPtr SoftObjectPtr = SoftObjectProperty->GetPropertyValue(SoftObjectProperty->ContainerPtrToValuePtr<uint8>(this));
-			UObject* Obj = SoftObjectPtr.Get();
+			UObject* Obj = GetResolvedSoftReference(It.GetIndex());
 			if (Obj && Obj->Implements<UXD_DispatchableEntityInterface>())
 			{
 				IXD_DispatchableEntityInterface::SetCurrentMainDispatcher(Obj, this);
@@ -366,6 +678,20 @@ void UXD_ActionDispatcherBase::ActiveDispatcher()
 		}
 	}
 
+	if (bLeaseEntities)
+	{
+		if (UXD_ActionDispatcherManager* Manager = GetManager())
+		{
+			for (TConstSetBitIterator<> It(GetEntityPropertyFlags()); It; ++It)
+			{
+				if (UObject* Obj = GetResolvedSoftReference(It.GetIndex()))
+				{
+					Manager->ReserveEntity(this, Obj, LeaseDuration);
+				}
+			}
+		}
+	}
+
 	if (UObject* Leader = DispatcherLeader.Get())
 	{
 		if (bIsPlayerLeader == true)
@@ -381,10 +707,33 @@ void UXD_ActionDispatcherBase::ActiveDispatcher()
 	WhenActived();
 }
 
-bool UXD_ActionDispatcherBase::IsAllSoftReferenceValid() const
+uint32 UXD_ActionDispatcherBase::SoftReferenceGeneration = 1;
+
+void UXD_ActionDispatcherBase::NotifySoftReferenceTargetsChanged()
 {
-	for (FSoftObjectProperty* SoftObjectProperty : GetSoftObjectPropertys())
+	// 0表示缓存无效
+	if (++SoftReferenceGeneration == 0)
 	{
+		++SoftReferenceGeneration;
+	}
+}
+
+void UXD_ActionDispatcherBase::UpdateSoftReferenceCache() const
+{
+	if (ResolvedGeneration == SoftReferenceGeneration)
+	{
+		return;
+	}
+	ResolvedGeneration = SoftReferenceGeneration;
+
+	// 管理器中的调度器共享解析结果
+	UXD_ActionDispatcherManager* Manager = GetManager();
+	const TArray<FSoftObjectProperty*>& Propertys = GetSoftObjectPropertys();
+	ResolvedSoftReferences.SetNum(Propertys.Num());
+	ResolvedSoftReferenceFlags.Init(false, Propertys.Num());
+	for (int32 Idx = 0; Idx < Propertys.Num(); ++Idx)
+	{
+		FSoftObjectProperty* SoftObjectProperty = Propertys[Idx];
 		FSoftObjectPtr SoftObjectPtr = SoftObjectProperty->GetPropertyValue(SoftObjectProperty->ContainerPtrToValuePtr<uint8>(this));
 #if WITH_EDITOR
 		if (SoftObjectPtr.IsNull())
@@ -392,9 +741,60 @@ bool UXD_ActionDispatcherBase::IsAllSoftReferenceValid() const
 			ActionDispatcher_Error_Log("调度器%s中的软引用[%s]为空，该调度器永远不会触发", *UXD_DebugFunctionLibrary::GetDebugName(this), *SoftObjectProperty->GetDisplayNameText().ToString());
 		}
 #endif
-		if (UObject* Obj = SoftObjectPtr.Get())
+		UObject* Obj = Manager ? Manager->ResolveSoftReference(SoftObjectPtr.ToSoftObjectPath()) : SoftObjectPtr.Get();
+		ResolvedSoftReferences[Idx] = Obj;
+		ResolvedSoftReferenceFlags[Idx] = Obj != nullptr;
+	}
+}
+
+void UXD_ActionDispatcherBase::GetSoftReferencePaths(TArray<FSoftObjectPath>& OutPaths) const
+{
+	for (FSoftObjectProperty* SoftObjectProperty : GetSoftObjectPropertys())
+	{
+		const FSoftObjectPtr& SoftObjectPtr = SoftObjectProperty->GetPropertyValue(SoftObjectProperty->ContainerPtrToValuePtr<uint8>(this));
+		if (SoftObjectPtr.IsNull() == false)
+		{
+			OutPaths.AddUnique(SoftObjectPtr.ToSoftObjectPath());
+		}
+	}
+}
+
+UObject* UXD_ActionDispatcherBase::GetResolvedSoftReference(int32 PropertyIndex) const
+{
+	UpdateSoftReferenceCache();
+	if (ResolvedSoftReferenceFlags[PropertyIndex])
+	{
+		if (UObject* Obj = ResolvedSoftReferences[PropertyIndex].Get())
 		{
-			if (Obj->Implements<UXD_DispatchableEntityInterface>())
+			return Obj;
+		}
+		// 对象已销毁，等待新对象出现后重新解析
+		ResolvedSoftReferenceFlags[PropertyIndex] = false;
+	}
+	return nullptr;
+}
+
+bool UXD_ActionDispatcherBase::IsAllSoftReferenceValid() const
+{
+	UpdateSoftReferenceCache();
+	// 存在未解析的软引用时不用再逐个检查
+	if (ResolvedSoftReferenceFlags.Find(false) != INDEX_NONE)
+	{
+		return false;
+	}
+
+	UXD_ActionDispatcherManager* Manager = GetManager();
+	const TBitArray<>& EntityFlags = GetEntityPropertyFlags();
+	for (int32 Idx = 0; Idx < ResolvedSoftReferences.Num(); ++Idx)
+	{
+		if (UObject* Obj = GetResolvedSoftReference(Idx))
+		{
+			// 被领导的调度器由领导者控制，不受租约限制
+			if (EntityFlags[Idx] && Manager && ActionDispatcherLeader == nullptr && Manager->IsEntityLeasedByOther(this, Obj))
+			{
+				return false;
+			}
+			if (EntityFlags[Idx] && Obj->Implements<UXD_DispatchableEntityInterface>())
 			{
 				if (IXD_DispatchableEntityInterface::CanExecuteDispatcher(Obj) == false)
 				{
@@ -402,12 +802,12 @@ bool UXD_ActionDispatcherBase::IsAllSoftReferenceValid() const
 				}
  				if (UXD_ActionDispatcherBase* MainDispatcher = IXD_DispatchableEntityInterface::GetCurrentMainDispatcher(Obj))
  				{
- 					//当主调度器（抢占式）存在的时候不能再启用别的调度器
+ 					//当主调度器（抢占式）存在的时候只有能抢占它的调度器能启用，与注册实体时的规则一致
   					if (MainDispatcher != this)
   					{
 						bool IsBeLeadingDispatcher = ActionDispatcherLeader ? true : false;
 
-						if (IsBeLeadingDispatcher == false)
+						if (IsBeLeadingDispatcher == false && CanPreempt(MainDispatcher) == false)
 						{
 							return false;
 						}
@@ -445,17 +845,23 @@ void UXD_ActionDispatcherBase::FinishDispatch(FGameplayTag Tag)
 	WhenDispatchFinishedNative.ExecuteIfBound(Tag.GetTagName());
 }
 
-#if WITH_EDITOR
 TArray<FName> UXD_ActionDispatcherBase::GetAllFinishTags() const
 {
-	UActionDispatcherBlueprint* AD_Blueprint = CastChecked<UActionDispatcherBlueprint>(CastChecked<UBlueprintGeneratedClass>(GetClass())->ClassGeneratedBy);
-	return AD_Blueprint->FinishTags;
-}
+	const UActionDispatcherGeneratedClass* GeneratedClass = CastChecked<UActionDispatcherGeneratedClass>(GetClass());
+#if WITH_EDITOR
+	// 旧资源未烘焙数据，从蓝图中读取
+	if (GeneratedClass->HasCompiledData() == false)
+	{
+		UActionDispatcherBlueprint* AD_Blueprint = CastChecked<UActionDispatcherBlueprint>(GeneratedClass->ClassGeneratedBy);
+		return AD_Blueprint->FinishTags;
+	}
 #endif
+	return GeneratedClass->FinishTags;
+}
 
-UXD_DispatchableActionBase* UXD_ActionDispatcherBase::FindAction(FGuid ActionGuid, TSubclassOf<UXD_DispatchableActionBase> ActionType) const
+UXD_DispatchableActionBase* UXD_ActionDispatcherBase::FindAction(int32 ActionIndex, TSubclassOf<UXD_DispatchableActionBase> ActionType) const
 {
-	UXD_DispatchableActionBase* Action = SavedActions.FindRef(ActionGuid);
+	UXD_DispatchableActionBase* Action = ActionDispatcherSlot::GetSlot(SavedActionSlots, ActionIndex);
 	check(Action && Action->IsA(ActionType));
 	return Action;
 }
@@ -463,7 +869,11 @@ UXD_DispatchableActionBase* UXD_ActionDispatcherBase::FindAction(FGuid ActionGui
 void UXD_ActionDispatcherBase::Reset()
 {
 	CurrentActions.Empty();
-	SavedActions.Empty();
+	SavedActionSlots.Empty();
+	if (ExtraState)
+	{
+		ExtraState->ActivedTogetherControl.Empty();
+	}
 }
 
 UXD_ActionDispatcherManager* UXD_ActionDispatcherBase::GetManager() const
@@ -482,21 +892,111 @@ UWorld* UXD_ActionDispatcherBase::GetWorld() const
 	return GetOuter()->GetWorld();
 }
 
-bool UXD_ActionDispatcherBase::EnterTogetherFlowControl(FGuid NodeGuid, int32 Index, int32 TogetherCount)
+void UXD_ActionDispatcherBase::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
 {
-	FTogetherFlowControl& TogetherFlowControl = ActivedTogetherControl.FindOrAdd(NodeGuid);
-	TogetherFlowControl.CheckList.SetNum(TogetherCount);
-	TogetherFlowControl.CheckList[Index] = true;
-	bool IsTogether = !TogetherFlowControl.CheckList.Contains(false);
-	if (IsTogether)
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// EstimatedTotal模式下UObject会统计序列化大小与子对象，只在Exclusive模式下统计容器分配
+	if (CumulativeResourceSize.GetResourceSizeMode() == EResourceSizeMode::Exclusive)
 	{
-		ActivedTogetherControl.Remove(NodeGuid);
-		return true;
+		CumulativeResourceSize.AddDedicatedSystemMemoryBytes(CurrentActions.GetAllocatedSize() + SavedActionSlots.GetAllocatedSize() + SavedActions.GetAllocatedSize() + ActivedSubActionDispatchers.GetAllocatedSize());
+		if (ClassData)
+		{
+			CumulativeResourceSize.AddDedicatedSystemMemoryBytes(sizeof(FActionDispatcherClassData) + ClassData->SoftObjectPropertys.GetAllocatedSize() + ClassData->EntityPropertyFlags.GetAllocatedSize());
+		}
+		if (ExtraState)
+		{
+			CumulativeResourceSize.AddDedicatedSystemMemoryBytes(ExtraState->GetClass()->GetStructureSize());
+			ExtraState->GetResourceSizeEx(CumulativeResourceSize);
+		}
 	}
-	else
+}
+
+UXD_ActionDispatcherExtraState& UXD_ActionDispatcherBase::GetOrCreateExtraState()
+{
+	if (ExtraState == nullptr)
 	{
+		ExtraState = NewObject<UXD_ActionDispatcherExtraState>(this);
+	}
+	return *ExtraState;
+}
+
+bool UXD_ActionDispatcherBase::EnterTogetherFlowControl(int32 NodeIndex, int32 Index, int32 TogetherCount, int32 RequiredCount, float Timeout, const FDispatchableActionEventDelegate& TimeoutEvent)
+{
+	check(NodeIndex >= 0 && Index >= 0 && Index < TogetherCount && TogetherCount <= FTogetherFlowControl::MaxTogetherCount);
+	TArray<FTogetherFlowControl>& ActivedTogetherControl = GetOrCreateExtraState().ActivedTogetherControl;
+	if (ActivedTogetherControl.Num() <= NodeIndex)
+	{
+		ActivedTogetherControl.Reserve(FMath::Max(GetNodeNum(EActionDispatcherNodeType::TogetherFlowControl), NodeIndex + 1));
+		ActivedTogetherControl.SetNum(NodeIndex + 1);
+	}
+	FTogetherFlowControl& TogetherFlowControl = ActivedTogetherControl[NodeIndex];
+
+	const uint32 AllMask = TogetherCount == FTogetherFlowControl::MaxTogetherCount ? MAX_uint32 : (1u << TogetherCount) - 1;
+	const int32 NeedCount = RequiredCount > 0 ? FMath::Min(RequiredCount, TogetherCount) : TogetherCount;
+
+	if (TogetherFlowControl.ArrivedMask == 0 && TogetherFlowControl.bFired == false && Timeout > 0.f)
+	{
+		TogetherFlowControl.RemainingTime = Timeout;
+		TogetherFlowControl.TimeoutEvent = TimeoutEvent;
+	}
+	TogetherFlowControl.ArrivedMask |= 1u << Index;
+
+	if (TogetherFlowControl.bFired)
+	{
+		// 本轮已触发，剩余的输入全部到达后重置
+		if ((TogetherFlowControl.ArrivedMask & AllMask) == AllMask)
+		{
+			TogetherFlowControl.Reset();
+		}
 		return false;
 	}
+
+	if (FPlatformMath::CountBits(TogetherFlowControl.ArrivedMask) >= NeedCount)
+	{
+		if ((TogetherFlowControl.ArrivedMask & AllMask) == AllMask)
+		{
+			TogetherFlowControl.Reset();
+		}
+		else
+		{
+			TogetherFlowControl.bFired = true;
+			TogetherFlowControl.RemainingTime = 0.f;
+		}
+		return true;
+	}
+	return false;
+}
+
+void UXD_ActionDispatcherBase::TickTogetherFlowControl(float DeltaTime)
+{
+	if (ExtraState == nullptr)
+	{
+		return;
+	}
+
+	// 触发超时事件可能会再次进入共同事件导致数组扩容，使用下标访问
+	TArray<FTogetherFlowControl>& ActivedTogetherControl = ExtraState->ActivedTogetherControl;
+	for (int32 Idx = 0; Idx < ActivedTogetherControl.Num(); ++Idx)
+	{
+		FTogetherFlowControl& TogetherFlowControl = ActivedTogetherControl[Idx];
+		if (TogetherFlowControl.RemainingTime > 0.f)
+		{
+			TogetherFlowControl.RemainingTime -= DeltaTime;
+			if (TogetherFlowControl.RemainingTime <= 0.f)
+			{
+				TogetherFlowControl.RemainingTime = 0.f;
+				TogetherFlowControl.bFired = true;
+				const FDispatchableActionEventDelegate TimeoutEvent = TogetherFlowControl.TimeoutEvent;
+				ActionDispatcher_Display_Log("调度器%s中共同事件[%d]超时", *UXD_DebugFunctionLibrary::GetDebugName(this), Idx);
+				TimeoutEvent.ExecuteIfBound();
+				if (State != EActionDispatcherState::Active)
+				{
+					return;
+				}
+			}
+		}
+	}
 }
 
 bool UXD_ActionDispatcherBase::IsSubActionDispatcher() const
@@ -521,22 +1021,21 @@ UXD_ActionDispatcherBase* UXD_ActionDispatcherBase::GetMainActionDispatcher()
 	return ActionDispatcher;
 }
 
-void UXD_ActionDispatcherBase::ActiveSubActionDispatcher(UXD_ActionDispatcherBase* SubActionDispatcher, FGuid NodeGuid)
+void UXD_ActionDispatcherBase::ActiveSubActionDispatcher(UXD_ActionDispatcherBase* SubActionDispatcher, int32 NodeIndex)
 {
 	check(SubActionDispatcher->State != EActionDispatcherState::Active);
 	SubActionDispatcher->State = EActionDispatcherState::Active;
 
-	ActivedSubActionDispatchers.Add(NodeGuid, SubActionDispatcher);
+	ActionDispatcherSlot::SetSlot(GetOrCreateExtraState().SubActionDispatcherSlots, NodeIndex, SubActionDispatcher, GetNodeNum(EActionDispatcherNodeType::SubActionDispatcher));
 	ActionDispatcher_Display_Log("启动子行为调度器%s", *UXD_DebugFunctionLibrary::GetDebugName(SubActionDispatcher));
 	SubActionDispatcher->WhenDispatchStart();
 }
 
-bool UXD_ActionDispatcherBase::TryActiveSubActionDispatcher(FGuid NodeGuid)
+bool UXD_ActionDispatcherBase::TryActiveSubActionDispatcher(int32 NodeIndex)
 {
-	UXD_ActionDispatcherBase** P_ActionDispatcher = ActivedSubActionDispatchers.Find(NodeGuid);
-	if (P_ActionDispatcher)
+	UXD_ActionDispatcherBase* ActionDispatcher = ExtraState ? ActionDispatcherSlot::GetSlot(ExtraState->SubActionDispatcherSlots, NodeIndex) : nullptr;
+	if (ActionDispatcher)
 	{
-		UXD_ActionDispatcherBase* ActionDispatcher = *P_ActionDispatcher;
 		ActionDispatcher->WhenDispatchStart();
 		return true;
 	}
@@ -546,6 +1045,69 @@ bool UXD_ActionDispatcherBase::TryActiveSubActionDispatcher(FGuid NodeGuid)
 	}
 }
 
+void UXD_ActionDispatcherBase::RemapLegacySaveData()
+{
+	if (SavedActions.Num() == 0 && ActivedSubActionDispatchers.Num() == 0)
+	{
+		return;
+	}
+
+	// 旧存档中子调度器的节点数据也储存在主调度器中，需查找节点所属的调度器
+	TArray<UXD_ActionDispatcherBase*> OwnerDispatchers{ this };
+	for (const TPair<FGuid, UXD_ActionDispatcherBase*>& Pair : ActivedSubActionDispatchers)
+	{
+		if (Pair.Value)
+		{
+			OwnerDispatchers.AddUnique(Pair.Value);
+		}
+	}
+
+	auto FindOwner = [&](const FGuid& NodeGuid, EActionDispatcherNodeType NodeType, int32& OutNodeIndex) -> UXD_ActionDispatcherBase*
+	{
+		for (UXD_ActionDispatcherBase* Dispatcher : OwnerDispatchers)
+		{
+			if (const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Dispatcher->GetClass()))
+			{
+				if (const FActionDispatcherNodeData* NodeData = GeneratedClass->FindNodeData(NodeGuid, NodeType))
+				{
+					OutNodeIndex = NodeData->TypeIndex;
+					return Dispatcher;
+				}
+			}
+		}
+		return nullptr;
+	};
+
+	for (const TPair<FGuid, UXD_ActionDispatcherBase*>& Pair : ActivedSubActionDispatchers)
+	{
+		int32 NodeIndex;
+		if (UXD_ActionDispatcherBase* Owner = FindOwner(Pair.Key, EActionDispatcherNodeType::SubActionDispatcher, NodeIndex))
+		{
+			ActionDispatcherSlot::SetSlot(Owner->GetOrCreateExtraState().SubActionDispatcherSlots, NodeIndex, Pair.Value, Owner->GetNodeNum(EActionDispatcherNodeType::SubActionDispatcher));
+		}
+		else
+		{
+			ActionDispatcher_Warning_LOG("调度器%s中旧存档的子调度器节点[%s]已不存在", *UXD_DebugFunctionLibrary::GetDebugName(this), *Pair.Key.ToString());
+		}
+	}
+
+	for (const TPair<FGuid, UXD_DispatchableActionBase*>& Pair : SavedActions)
+	{
+		int32 NodeIndex;
+		if (UXD_ActionDispatcherBase* Owner = FindOwner(Pair.Key, EActionDispatcherNodeType::Action, NodeIndex))
+		{
+			ActionDispatcherSlot::SetSlot(Owner->SavedActionSlots, NodeIndex, Pair.Value, Owner->GetNodeNum(EActionDispatcherNodeType::Action));
+		}
+		else
+		{
+			ActionDispatcher_Warning_LOG("调度器%s中旧存档的行为节点[%s]已不存在", *UXD_DebugFunctionLibrary::GetDebugName(this), *Pair.Key.ToString());
+		}
+	}
+
+	SavedActions.Empty();
+	ActivedSubActionDispatchers.Empty();
+}
+
 void UXD_ActionDispatcherBase::WhenDeactived(bool IsFinsihedCompleted)
 {
 	ReceiveWhenDeactived(IsFinsihedCompleted);
@@ -1,11 +1,26 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Interface/XD_DispatchableEntityInterface.h"
+#include <GameFramework/Actor.h>
 
 // Add default functionality here for any IXD_DispatchableEntityInterface functions that are not pure virtual.
 
+UXD_DA_StateTagComponent* UXD_DA_StateTagUtils::FindStateTagComponent(UObject* Obj)
+{
+	if (AActor* Actor = Cast<AActor>(Obj))
+	{
+		return Actor->FindComponentByClass<UXD_DA_StateTagComponent>();
+	}
+	return nullptr;
+}
+
 bool UXD_DA_StateTagUtils::HasStateTag(UObject* Obj, FGameplayTag Tag)
 {
+	// 有状态Tag组件时直接读取状态位，不经过接口
+	if (UXD_DA_StateTagComponent* StateTagComponent = FindStateTagComponent(Obj))
+	{
+		return StateTagComponent->HasStateTag(Tag);
+	}
 	if (Obj && Obj->Implements<UXD_DispatchableEntityInterface>())
 	{
 		return IXD_DispatchableEntityInterface::Execute_AD_HasStateTag(Obj, Tag);
@@ -15,8 +30,39 @@ bool UXD_DA_StateTagUtils::HasStateTag(UObject* Obj, FGameplayTag Tag)
 
 void UXD_DA_StateTagUtils::AddStateTag(UObject* Obj, FGameplayTag Tag)
 {
+	if (UXD_DA_StateTagComponent* StateTagComponent = FindStateTagComponent(Obj))
+	{
+		StateTagComponent->AddStateTag(Tag);
+		return;
+	}
 	if (Obj && Obj->Implements<UXD_DispatchableEntityInterface>())
 	{
 		return IXD_DispatchableEntityInterface::Execute_AD_AddStateTag(Obj, Tag);
 	}
 }
+
+bool UXD_DA_StateTagUtils::MatchStateTagQuery(UObject* Obj, const FXD_DA_StateTagQuery& Query)
+{
+	if (UXD_DA_StateTagComponent* StateTagComponent = FindStateTagComponent(Obj))
+	{
+		return StateTagComponent->MatchesStateTagQuery(Query);
+	}
+	if (Obj && Obj->Implements<UXD_DispatchableEntityInterface>())
+	{
+		// 未添加组件的实体逐个Tag通过接口查询
+		return Query.Evaluate([&](int32 TagIdx) { return IXD_DispatchableEntityInterface::Execute_AD_HasStateTag(Obj, Query.Tags[TagIdx]); });
+	}
+	return false;
+}
+
+int32 UXD_DA_StateTagUtils::MatchStateTagQueryBatch(const TArray<AActor*>& Entities, const FXD_DA_StateTagQuery& Query, TArray<bool>& OutResults)
+{
+	int32 MatchNum = 0;
+	OutResults.SetNumUninitialized(Entities.Num());
+	for (int32 Idx = 0; Idx < Entities.Num(); ++Idx)
+	{
+		OutResults[Idx] = MatchStateTagQuery(Entities[Idx], Query);
+		MatchNum += OutResults[Idx] ? 1 : 0;
+	}
+	return MatchNum;
+}
@@ -3,6 +3,8 @@
 #include "Manager/XD_ActionDispatcherManager.h"
 #include <GameFramework/GameStateBase.h>
 #include <Engine/LevelStreaming.h>
+#include <Engine/Level.h>
+#include <Engine/World.h>
 
 #include "XD_DebugFunctionLibrary.h"
 #include "XD_ActorFunctionLibrary.h"
@@ -11,6 +13,14 @@
 #include "Interface/XD_ActionDispatcherGameStateImpl.h"
 #include "Dispatcher/XD_ActionDispatcherBase.h"
 #include "Action/XD_DispatchableActionBase.h"
+#include "Utils/XD_ActionDispatcher_Stats.h"
+#include "Settings/XD_ActionDispatcherSettings.h"
+#include <Async/ParallelFor.h>
+#include <UObject/UObjectHash.h>
+#include <UObject/Package.h>
+#include <Serialization/MemoryWriter.h>
+#include <Serialization/MemoryReader.h>
+#include <Serialization/ObjectAndNameAsStringProxyArchive.h>
 
 // Sets default values for this component's properties
 UXD_ActionDispatcherManager::UXD_ActionDispatcherManager()
@@ -20,6 +30,7 @@ UXD_ActionDispatcherManager::UXD_ActionDispatcherManager()
 	PrimaryComponentTick.bCanEverTick = true;
 
 	// ...
+	ActionTimerWheel.SetResolution(GetDefault<UXD_ActionDispatcherSettings>()->ActionTimerResolution);
 }
 
 
@@ -30,10 +41,16 @@ void UXD_ActionDispatcherManager::BeginPlay()
 
 	// ...
 	UXD_SaveGameSystemBase::Get(this)->OnLoadLevelCompleted.AddUObject(this, &UXD_ActionDispatcherManager::WhenLevelLoadCompleted);
+	UXD_SaveGameSystemBase::Get(this)->OnPreLevelUnload.AddUObject(this, &UXD_ActionDispatcherManager::WhenPreLevelUnload);
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UXD_ActionDispatcherManager::WhenActorSpawned));
 
 	for (ULevelStreaming* LevelStream : GetWorld()->GetStreamingLevels())
 	{
 		LevelStream->OnLevelUnloaded.AddDynamic(this, &UXD_ActionDispatcherManager::WhenPostLevelUnload);
+		if (LevelStream->IsLevelLoaded() == false)
+		{
+			UnloadedLevels.Add(LevelStream->GetWorldAssetPackageFName());
+		}
 	}
 }
 
@@ -42,6 +59,8 @@ void UXD_ActionDispatcherManager::EndPlay(const EEndPlayReason::Type EndPlayReas
 	Super::EndPlay(EndPlayReason);
 
 	UXD_SaveGameSystemBase::Get(this)->OnLoadLevelCompleted.RemoveAll(this);
+	UXD_SaveGameSystemBase::Get(this)->OnPreLevelUnload.RemoveAll(this);
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
 }
 
 void UXD_ActionDispatcherManager::WhenGameInit_Implementation()
@@ -51,10 +70,12 @@ void UXD_ActionDispatcherManager::WhenGameInit_Implementation()
 
 void UXD_ActionDispatcherManager::WhenPreSave_Implementation()
 {
+	CompactPendingDispatchers();
 	for (UXD_ActionDispatcherBase* Dispatcher : ActivedDispatchers)
 	{
 		Dispatcher->SaveDispatchState();
 	}
+	SaveEntityLeases();
 }
 
 void UXD_ActionDispatcherManager::WhenPostLoad_Implementation()
@@ -64,6 +85,11 @@ void UXD_ActionDispatcherManager::WhenPostLoad_Implementation()
 	FTimerHandle TimeHandle;
 	GetWorld()->GetTimerManager().SetTimer(TimeHandle, FTimerDelegate::CreateWeakLambda(this, [this] 
 	{
+		UXD_ActionDispatcherBase::NotifySoftReferenceTargetsChanged();
+		// 先移除读档后为空的调度器，之后的处理都假定列表中没有空项
+		RebuildDispatcherIndices();
+		RebuildEntityReferences();
+		RestoreEntityLeases();
 		for (UXD_ActionDispatcherBase* Dispatcher : TArray<UXD_ActionDispatcherBase*>(ActivedDispatchers))
 		{
 			if (Dispatcher->CanReactiveDispatcher())
@@ -82,6 +108,7 @@ void UXD_ActionDispatcherManager::WhenPostLoad_Implementation()
 			{
 				Dispatcher->State = EActionDispatcherState::Active;
 				Dispatcher->AbortDispatch();
+				EnqueueLeaseWaiter(Dispatcher);
 			}
 		}
 
@@ -95,72 +122,189 @@ void UXD_ActionDispatcherManager::TickComponent(float DeltaTime, ELevelTick Tick
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
 	// ...
-	if (bEnableAutoActivePendingAction)
+	ActionTimerWheel.Advance(DeltaTime, [](UXD_DispatchableActionBase* Action, EDispatchableActionTimerType Type)
+		{
+			Action->WhenTimerFired(Type);
+		}, [this](TObjectKey<UObject> Entity)
+		{
+			WhenLeaseExpired(Entity);
+		});
+
+	if (PendingHoleNum * 2 > PendingDispatchers.Num())
+	{
+		CompactPendingDispatchers();
+	}
+	if (bEnableAutoActivePendingAction && GetPendingDispatcherNum() > 0)
 	{
-		double StartTime = FPlatformTime::Seconds();
-		double ActivePendingActionsTimeLimit = 0.001f;
-		while (ActivePendingActionIdx < PendingDispatchers.Num())
+		const UXD_ActionDispatcherSettings* Settings = GetDefault<UXD_ActionDispatcherSettings>();
+		if (ActivePendingActionIdx >= PendingDispatchers.Num())
 		{
-			UXD_ActionDispatcherBase* PendingDispatcher = PendingDispatchers[ActivePendingActionIdx];
-			if (PendingDispatcher->IsDispatcherStarted())
+			ActivePendingActionIdx = 0;
+		}
+
+		// 游戏线程收集快照，工作线程预检查，通过预检查的调度器再在游戏线程中确认
+		const int32 BatchStart = ActivePendingActionIdx;
+		const int32 BatchEnd = FMath::Min(BatchStart + Settings->PendingEvaluateBatchNum, PendingDispatchers.Num());
+		TArray<UXD_ActionDispatcherBase*> BatchDispatchers;
+		BatchDispatchers.Reserve(BatchEnd - BatchStart);
+		for (int32 Idx = BatchStart; Idx < BatchEnd; ++Idx)
+		{
+			if (PendingDispatchers[Idx] && IsWaitingUnloadedLevel(PendingDispatchers[Idx]) == false)
 			{
-				if (PendingDispatcher->CanReactiveDispatcher())
-				{
-					PendingDispatcher->ReactiveDispatcher();
-					PendingDispatchers.RemoveAt(ActivePendingActionIdx);
-					WhenDispatcherReactived(PendingDispatcher);
-				}
-				else
-				{
-					++ActivePendingActionIdx;
-				}
+				BatchDispatchers.Add(PendingDispatchers[Idx]);
 			}
-			else
+		}
+		const int32 BatchNum = BatchDispatchers.Num();
+		TArray<FActionDispatcherStartSnapshot> Snapshots;
+		Snapshots.SetNum(BatchNum);
+		TArray<UObject*> SoftReferences;
+		TArray<const UXD_ActionDispatcherBase*> MainDispatchers;
+		for (int32 Idx = 0; Idx < BatchNum; ++Idx)
+		{
+			BatchDispatchers[Idx]->MakeStartSnapshot(Snapshots[Idx], SoftReferences, MainDispatchers);
+		}
+		// 收集完成后数组不再扩容，再设置各快照的视图
+		for (int32 Idx = 0; Idx < BatchNum; ++Idx)
+		{
+			FActionDispatcherStartSnapshot& Snapshot = Snapshots[Idx];
+			const int32 SoftReferenceEnd = Idx + 1 < BatchNum ? Snapshots[Idx + 1].SoftReferenceStart : SoftReferences.Num();
+			const int32 SoftReferenceNum = SoftReferenceEnd - Snapshot.SoftReferenceStart;
+			Snapshot.SoftReferences = TArrayView<UObject* const>(SoftReferences.GetData() + Snapshot.SoftReferenceStart, SoftReferenceNum);
+			Snapshot.MainDispatchers = TArrayView<const UXD_ActionDispatcherBase* const>(MainDispatchers.GetData() + Snapshot.SoftReferenceStart, SoftReferenceNum);
+		}
+
+		TArray<bool> EvaluateResults;
+		EvaluateResults.SetNumZeroed(BatchNum);
+		ParallelFor(BatchNum, [&](int32 Idx)
 			{
-				if (PendingDispatcher->CanStartDispatcher())
-				{
-					PendingDispatcher->StartDispatch();
-					PendingDispatchers.RemoveAt(ActivePendingActionIdx);
-					WhenDispatcherStarted(PendingDispatcher);
-				}
-				else
-				{
-					++ActivePendingActionIdx;
-				}
-			}
+				const FActionDispatcherStartSnapshot& Snapshot = Snapshots[Idx];
+				EvaluateResults[Idx] = Snapshot.bGameThreadOnly || Snapshot.Dispatcher->CanStartDispatcher_AnyThread(Snapshot);
+			}, BatchNum < Settings->ParallelEvaluateMinNum);
 
-			if (FPlatformTime::Seconds() - StartTime > ActivePendingActionsTimeLimit)
+		TArray<UXD_ActionDispatcherBase*> Candidates;
+		for (int32 Idx = 0; Idx < BatchNum; ++Idx)
+		{
+			if (EvaluateResults[Idx])
 			{
-				break;
+				Candidates.Add(BatchDispatchers[Idx]);
 			}
 		}
-		if (ActivePendingActionIdx >= PendingDispatchers.Num())
+
+		ActivePendingActionIdx = BatchEnd;
+		const double StartTime = FPlatformTime::Seconds();
+		for (UXD_ActionDispatcherBase* Candidate : Candidates)
 		{
-			ActivePendingActionIdx = 0;
+			if (FPlatformTime::Seconds() - StartTime > Settings->ActivePendingTimeLimit)
+			{
+				// 超时后下一帧从未确认的调度器开始检查
+				if (IsPendingDispatcher(Candidate))
+				{
+					ActivePendingActionIdx = Candidate->ManagerIndex;
+				}
+				break;
+			}
+			// 之前激活的调度器可能已经唤醒或移除了该调度器
+			TryWakePendingDispatcher(Candidate);
 		}
 	}
 }
 
 void UXD_ActionDispatcherManager::WhenDispatcherStarted(UXD_ActionDispatcherBase* Dispatcher)
 {
-	check(!ActivedDispatchers.Contains(Dispatcher));
-
-	ActivedDispatchers.Add(Dispatcher);
+	AddActivedDispatcher(Dispatcher);
 }
 
 void UXD_ActionDispatcherManager::WhenDispatcherReactived(UXD_ActionDispatcherBase* Dispatcher)
 {
-	check(!ActivedDispatchers.Contains(Dispatcher));
-
-	ActivedDispatchers.Add(Dispatcher);
+	AddActivedDispatcher(Dispatcher);
 }
 
 void UXD_ActionDispatcherManager::WhenDispatcherDeactived(UXD_ActionDispatcherBase* Dispatcher)
 {
-	check(ActivedDispatchers.Contains(Dispatcher));
+	RemoveActivedDispatcher(Dispatcher);
+	AddPendingDispatcher(Dispatcher);
+}
+
+bool UXD_ActionDispatcherManager::IsActivedDispatcher(const UXD_ActionDispatcherBase* Dispatcher) const
+{
+	return ActivedDispatchers.IsValidIndex(Dispatcher->ManagerIndex) && ActivedDispatchers[Dispatcher->ManagerIndex] == Dispatcher;
+}
+
+bool UXD_ActionDispatcherManager::IsPendingDispatcher(const UXD_ActionDispatcherBase* Dispatcher) const
+{
+	return PendingDispatchers.IsValidIndex(Dispatcher->ManagerIndex) && PendingDispatchers[Dispatcher->ManagerIndex] == Dispatcher;
+}
+
+void UXD_ActionDispatcherManager::AddActivedDispatcher(UXD_ActionDispatcherBase* Dispatcher)
+{
+	check(!IsActivedDispatcher(Dispatcher) && !IsPendingDispatcher(Dispatcher));
+
+	Dispatcher->ManagerIndex = ActivedDispatchers.Add(Dispatcher);
+}
+
+void UXD_ActionDispatcherManager::RemoveActivedDispatcher(UXD_ActionDispatcherBase* Dispatcher)
+{
+	check(IsActivedDispatcher(Dispatcher));
+
+	const int32 Idx = Dispatcher->ManagerIndex;
+	ActivedDispatchers.RemoveAtSwap(Idx, 1, false);
+	if (ActivedDispatchers.IsValidIndex(Idx))
+	{
+		ActivedDispatchers[Idx]->ManagerIndex = Idx;
+	}
+	Dispatcher->ManagerIndex = INDEX_NONE;
+}
+
+void UXD_ActionDispatcherManager::RemovePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher)
+{
+	check(IsPendingDispatcher(Dispatcher));
+
+	PendingDispatchers[Dispatcher->ManagerIndex] = nullptr;
+	PendingHoleNum += 1;
+	Dispatcher->ManagerIndex = INDEX_NONE;
+}
+
+void UXD_ActionDispatcherManager::CompactPendingDispatchers()
+{
+	if (PendingHoleNum == 0)
+	{
+		return;
+	}
 
-	ActivedDispatchers.Remove(Dispatcher);
-	PendingDispatchers.Add(Dispatcher);
+	int32 NewActivePendingActionIdx = INDEX_NONE;
+	int32 NewIdx = 0;
+	for (int32 Idx = 0; Idx < PendingDispatchers.Num(); ++Idx)
+	{
+		if (Idx == ActivePendingActionIdx)
+		{
+			NewActivePendingActionIdx = NewIdx;
+		}
+		if (UXD_ActionDispatcherBase* Dispatcher = PendingDispatchers[Idx])
+		{
+			Dispatcher->ManagerIndex = NewIdx;
+			PendingDispatchers[NewIdx++] = Dispatcher;
+		}
+	}
+	PendingDispatchers.SetNum(NewIdx, false);
+	PendingHoleNum = 0;
+	ActivePendingActionIdx = NewActivePendingActionIdx != INDEX_NONE ? NewActivePendingActionIdx : NewIdx;
+}
+
+void UXD_ActionDispatcherManager::RebuildDispatcherIndices()
+{
+	ActivedDispatchers.Remove(nullptr);
+	PendingDispatchers.Remove(nullptr);
+	PendingHoleNum = 0;
+	// 排序需在移除空项后，序号需在排序后
+	PendingDispatchers.StableSort([](const UXD_ActionDispatcherBase& LHS, const UXD_ActionDispatcherBase& RHS) { return LHS.Priority > RHS.Priority; });
+	for (int32 Idx = 0; Idx < ActivedDispatchers.Num(); ++Idx)
+	{
+		ActivedDispatchers[Idx]->ManagerIndex = Idx;
+	}
+	for (int32 Idx = 0; Idx < PendingDispatchers.Num(); ++Idx)
+	{
+		PendingDispatchers[Idx]->ManagerIndex = Idx;
+	}
 }
 
 UXD_ActionDispatcherManager* UXD_ActionDispatcherManager::Get(const UObject* WorldContextObject)
@@ -182,17 +326,136 @@ UXD_ActionDispatcherManager* UXD_ActionDispatcherManager::Get(const UObject* Wor
 	}
 }
 
+void UXD_ActionDispatcherManager::WhenDispatcherRejected(UXD_ActionDispatcherBase* Dispatcher)
+{
+	if (IsPendingDispatcher(Dispatcher))
+	{
+		ActionDispatcher_Display_Log("行为调度器%s放弃执行", *UXD_DebugFunctionLibrary::GetDebugName(Dispatcher));
+		RemovePendingDispatcher(Dispatcher);
+		UnregisterDispatcherReferences(Dispatcher);
+		ReleaseAllEntities(Dispatcher);
+	}
+}
+
+void UXD_ActionDispatcherManager::AddPendingDispatcher(UXD_ActionDispatcherBase* Dispatcher)
+{
+	check(!IsActivedDispatcher(Dispatcher) && !IsPendingDispatcher(Dispatcher));
+
+	// 从末尾查找插入位置，相同优先级的常见情况下直接追加
+	int32 InsertIdx = PendingDispatchers.Num();
+	while (InsertIdx > 0 && (PendingDispatchers[InsertIdx - 1] == nullptr || PendingDispatchers[InsertIdx - 1]->Priority < Dispatcher->Priority))
+	{
+		InsertIdx -= 1;
+	}
+	if (InsertIdx == PendingDispatchers.Num())
+	{
+		Dispatcher->ManagerIndex = PendingDispatchers.Add(Dispatcher);
+	}
+	else
+	{
+		PendingDispatchers.Insert(Dispatcher, InsertIdx);
+		for (int32 Idx = InsertIdx; Idx < PendingDispatchers.Num(); ++Idx)
+		{
+			if (PendingDispatchers[Idx])
+			{
+				PendingDispatchers[Idx]->ManagerIndex = Idx;
+			}
+		}
+		// 插入到轮询位置之前时从插入位置开始轮询，保证高优先级的调度器先检查
+		if (InsertIdx < ActivePendingActionIdx)
+		{
+			ActivePendingActionIdx = InsertIdx;
+		}
+	}
+}
+
+void UXD_ActionDispatcherManager::AddPendingDispatchers(const TArray<UXD_ActionDispatcherBase*>& SortedDispatchers)
+{
+	if (SortedDispatchers.Num() == 0)
+	{
+		return;
+	}
+
+	// 合并两个有序数组，只分配一次，同时去掉等待队列中的空位
+	TArray<UXD_ActionDispatcherBase*> MergedDispatchers;
+	MergedDispatchers.Reserve(GetPendingDispatcherNum() + SortedDispatchers.Num());
+	int32 FirstInsertIdx = INDEX_NONE;
+	int32 NewActivePendingActionIdx = INDEX_NONE;
+	int32 PendingIdx = 0;
+	int32 SortedIdx = 0;
+	while (PendingIdx < PendingDispatchers.Num() || SortedIdx < SortedDispatchers.Num())
+	{
+		if (PendingIdx < PendingDispatchers.Num() && PendingDispatchers[PendingIdx] == nullptr)
+		{
+			if (PendingIdx == ActivePendingActionIdx)
+			{
+				NewActivePendingActionIdx = MergedDispatchers.Num();
+			}
+			PendingIdx += 1;
+			continue;
+		}
+		const bool TakeSorted = SortedIdx < SortedDispatchers.Num() && (PendingIdx == PendingDispatchers.Num() || PendingDispatchers[PendingIdx]->Priority < SortedDispatchers[SortedIdx]->Priority);
+		UXD_ActionDispatcherBase* Dispatcher;
+		if (TakeSorted)
+		{
+			Dispatcher = SortedDispatchers[SortedIdx++];
+			check(!IsActivedDispatcher(Dispatcher) && !IsPendingDispatcher(Dispatcher));
+			if (FirstInsertIdx == INDEX_NONE)
+			{
+				FirstInsertIdx = MergedDispatchers.Num();
+			}
+		}
+		else
+		{
+			if (PendingIdx == ActivePendingActionIdx && NewActivePendingActionIdx == INDEX_NONE)
+			{
+				NewActivePendingActionIdx = MergedDispatchers.Num();
+			}
+			Dispatcher = PendingDispatchers[PendingIdx++];
+		}
+		Dispatcher->ManagerIndex = MergedDispatchers.Add(Dispatcher);
+	}
+	PendingDispatchers = MoveTemp(MergedDispatchers);
+	PendingHoleNum = 0;
+	if (NewActivePendingActionIdx == INDEX_NONE)
+	{
+		NewActivePendingActionIdx = PendingDispatchers.Num();
+	}
+	// 与AddPendingDispatcher一致，插入到轮询位置之前时从插入位置开始轮询
+	ActivePendingActionIdx = FMath::Min(FirstInsertIdx, NewActivePendingActionIdx);
+}
+
 void UXD_ActionDispatcherManager::WhenDispatcherFinished(UXD_ActionDispatcherBase* Dispatcher)
 {
-	check(ActivedDispatchers.Contains(Dispatcher));
+	RemoveActivedDispatcher(Dispatcher);
 
-	ActivedDispatchers.Remove(Dispatcher);
+	// 调度器结束后释放了引用的实体，唤醒等待这些实体的调度器
+	TArray<TWeakObjectPtr<UObject>> ReleasedEntities;
+	TArray<FSoftObjectPath> Paths;
+	Dispatcher->GetSoftReferencePaths(Paths);
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		if (const FDispatcherEntityReference* Reference = EntityReferences.Find(Path))
+		{
+			ReleasedEntities.Add(Reference->Entity);
+		}
+	}
+	UnregisterDispatcherReferences(Dispatcher);
+	ReleaseAllEntities(Dispatcher);
+	for (const TWeakObjectPtr<UObject>& Entity : ReleasedEntities)
+	{
+		if (Entity.IsValid())
+		{
+			WakeDispatchersReferencing(Entity.Get());
+		}
+	}
 
 	InvokeActivePendingActions();
 }
 
 void UXD_ActionDispatcherManager::InvokeStartDispatcher(UXD_ActionDispatcherBase* Dispatcher)
 {
+	RegisterDispatcherReferences(Dispatcher);
 	if (Dispatcher->CanStartDispatcher())
 	{
 		WhenDispatcherStarted(Dispatcher);
@@ -200,9 +463,77 @@ void UXD_ActionDispatcherManager::InvokeStartDispatcher(UXD_ActionDispatcherBase
 	}
 	else
 	{
-		check(!PendingDispatchers.Contains(Dispatcher));
+		AddPendingDispatcher(Dispatcher);
+		EnqueueLeaseWaiter(Dispatcher);
+	}
+}
+
+void UXD_ActionDispatcherManager::StartDispatchers(const TArray<UXD_ActionDispatcherBase*>& Dispatchers, const TArray<TSoftObjectPtr<AActor>>& Leaders)
+{
+	if (!ensureMsgf(Leaders.Num() == 0 || Leaders.Num() == Dispatchers.Num(), TEXT("Leaders的数量需与Dispatchers一致")))
+	{
+		return;
+	}
 
-		PendingDispatchers.Add(Dispatcher);
+	TArray<UXD_ActionDispatcherBase*> StartingDispatchers;
+	StartingDispatchers.Reserve(Dispatchers.Num());
+	TSet<UXD_ActionDispatcherBase*> AddedDispatchers;
+	AddedDispatchers.Reserve(Dispatchers.Num());
+	for (int32 Idx = 0; Idx < Dispatchers.Num(); ++Idx)
+	{
+		UXD_ActionDispatcherBase* Dispatcher = Dispatchers[Idx];
+		bool IsAlreadyInSet = false;
+		if (Dispatcher)
+		{
+			AddedDispatchers.Add(Dispatcher, &IsAlreadyInSet);
+		}
+		if (Dispatcher == nullptr || IsAlreadyInSet || Dispatcher->IsDispatcherStarted() || IsPendingDispatcher(Dispatcher))
+		{
+			ActionDispatcher_Warning_LOG("批量启动调度器时跳过无效、重复或已启动的调度器%s", *UXD_DebugFunctionLibrary::GetDebugName(Dispatcher));
+			continue;
+		}
+		// 只给通过检查的调度器设置领导者，跳过的调度器保持原状
+		if (Leaders.Num() > 0 && Leaders[Idx].IsNull() == false)
+		{
+			Dispatcher->InitLeader(Leaders[Idx]);
+		}
+		StartingDispatchers.Add(Dispatcher);
+	}
+	StartingDispatchers.StableSort([](const UXD_ActionDispatcherBase& LHS, const UXD_ActionDispatcherBase& RHS) { return LHS.Priority > RHS.Priority; });
+
+	// 同一批调度器引用的软引用路径只解析一次，之后调度器的检查直接使用索引中的结果
+	TSet<FSoftObjectPath> Paths;
+	for (UXD_ActionDispatcherBase* Dispatcher : StartingDispatchers)
+	{
+		RegisterDispatcherReferences(Dispatcher, &Paths);
+	}
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		ResolveSoftReference(Path);
+	}
+
+	ActivedDispatchers.Reserve(ActivedDispatchers.Num() + StartingDispatchers.Num());
+	TArray<UXD_ActionDispatcherBase*> DelayedDispatchers;
+	DelayedDispatchers.Reserve(StartingDispatchers.Num());
+	const float TimeLimit = GetDefault<UXD_ActionDispatcherSettings>()->BulkStartTimeLimit;
+	const double StartTime = FPlatformTime::Seconds();
+	for (UXD_ActionDispatcherBase* Dispatcher : StartingDispatchers)
+	{
+		// 超时后剩余的调度器交给等待队列分帧启动，未超时时无法启动的调度器不影响之后的调度器
+		if (FPlatformTime::Seconds() - StartTime <= TimeLimit && Dispatcher->CanStartDispatcher())
+		{
+			WhenDispatcherStarted(Dispatcher);
+			Dispatcher->StartDispatch();
+		}
+		else
+		{
+			DelayedDispatchers.Add(Dispatcher);
+		}
+	}
+	AddPendingDispatchers(DelayedDispatchers);
+	for (UXD_ActionDispatcherBase* Dispatcher : DelayedDispatchers)
+	{
+		EnqueueLeaseWaiter(Dispatcher);
 	}
 }
 
@@ -213,31 +544,294 @@ void UXD_ActionDispatcherManager::InvokeActivePendingActions()
 
 void UXD_ActionDispatcherManager::WhenLevelLoadCompleted(ULevel* Level)
 {
+	UXD_ActionDispatcherBase::NotifySoftReferenceTargetsChanged();
+
+	const FName LevelName = GetLevelPackageName(Level);
+	UnloadedLevels.Remove(LevelName);
+	RestoreLevelDispatchers(LevelName);
+	if (const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>* Dispatchers = LevelDispatchers.Find(LevelName))
+	{
+		// 激活的调度器可能直接结束导致分组改变，先复制一份
+		for (UXD_ActionDispatcherBase* Dispatcher : GetLiveDispatchers(*Dispatchers))
+		{
+			TryWakePendingDispatcher(Dispatcher);
+		}
+	}
 	InvokeActivePendingActions();
 }
 
+void UXD_ActionDispatcherManager::WhenPreLevelUnload(ULevel* Level)
+{
+	const FName LevelName = GetLevelPackageName(Level);
+	UnloadedLevels.Add(LevelName);
+	UnloadingLevels.AddUnique(LevelName);
+}
+
+FName UXD_ActionDispatcherManager::GetLevelPackageName(const ULevel* Level)
+{
+	return Level ? Level->GetOutermost()->GetFName() : NAME_None;
+}
+
+bool UXD_ActionDispatcherManager::IsWaitingUnloadedLevel(const UXD_ActionDispatcherBase* Dispatcher) const
+{
+	if (UnloadedLevels.Num() > 0)
+	{
+		for (const FName& LevelName : Dispatcher->ReferencedLevels)
+		{
+			if (UnloadedLevels.Contains(LevelName))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void UXD_ActionDispatcherManager::WhenActorSpawned(AActor* Actor)
+{
+	// 只有被调度器引用的Actor才需要刷新缓存，子弹、特效等生成不影响调度器
+	if (EntityReferences.Num() > 0)
+	{
+		const FSoftObjectPath Path(Actor);
+		if (FDispatcherEntityReference* Reference = EntityReferences.Find(Path))
+		{
+			for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Dispatcher : Reference->Dispatchers)
+			{
+				if (Dispatcher.IsValid())
+				{
+					Dispatcher->InvalidateSoftReferenceCache();
+				}
+			}
+			SetReferencedEntity(*Reference, Path, Actor);
+			WakeDispatchersReferencing(Actor);
+		}
+	}
+}
+
 void UXD_ActionDispatcherManager::WhenPostLevelUnload()
 {
-	for (int32 i = 0; i < ActivedDispatchers.Num();)
+	// 只检查引用了卸载关卡中实体的调度器
+	const TArray<FName> Levels = MoveTemp(UnloadingLevels);
+	for (const FName& LevelName : Levels)
 	{
-		UXD_ActionDispatcherBase* Dispatcher = ActivedDispatchers[i];
-		if (Dispatcher->DispatcherLeader.IsNull() && Dispatcher->IsDispatcherValid() == false)
+		const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>* Dispatchers = LevelDispatchers.Find(LevelName);
+		if (Dispatchers == nullptr)
+		{
+			continue;
+		}
+		for (UXD_ActionDispatcherBase* Dispatcher : GetLiveDispatchers(*Dispatchers))
 		{
-			//太Hack了，想办法修正调用时序修改这个
-			Dispatcher->State = EActionDispatcherState::Deactive;
-			for (UXD_DispatchableActionBase* DispatchableAction : Dispatcher->CurrentActions)
+			if (IsActivedDispatcher(Dispatcher) && Dispatcher->DispatcherLeader.IsNull() && Dispatcher->IsDispatcherValid() == false)
 			{
-				DispatchableAction->State = EDispatchableActionState::Deactive;
+				//太Hack了，想办法修正调用时序修改这个
+				Dispatcher->State = EActionDispatcherState::Deactive;
+				for (UXD_DispatchableActionBase* DispatchableAction : Dispatcher->CurrentActions)
+				{
+					DispatchableAction->State = EDispatchableActionState::Deactive;
+				}
+
+				RemoveActivedDispatcher(Dispatcher);
+				AddPendingDispatcher(Dispatcher);
 			}
+		}
+		if (GetDefault<UXD_ActionDispatcherSettings>()->bUnloadDispatchersWithLevel)
+		{
+			UnloadLevelDispatchers(LevelName);
+		}
+	}
+}
 
-			ActivedDispatchers.RemoveAt(i);
-			PendingDispatchers.Add(Dispatcher);
+namespace ActionDispatcherLevelRecord
+{
+	// 同一份记录内对象间的引用按序号保存，还原时对象名可以不同
+	class FRecordArchive : public FObjectAndNameAsStringProxyArchive
+	{
+	public:
+		FRecordArchive(FArchive& InInnerArchive, TArray<UObject*>& InObjects)
+			: FObjectAndNameAsStringProxyArchive(InInnerArchive, true), Objects(InObjects)
+		{
+			ArIsSaveGame = true;
 		}
-		else
+
+		FArchive& operator<<(UObject*& Obj) override
+		{
+			int32 ObjectIdx = IsLoading() ? INDEX_NONE : Objects.IndexOfByKey(Obj);
+			InnerArchive << ObjectIdx;
+			if (ObjectIdx == INDEX_NONE)
+			{
+				return FObjectAndNameAsStringProxyArchive::operator<<(Obj);
+			}
+			if (IsLoading())
+			{
+				Obj = Objects.IsValidIndex(ObjectIdx) ? Objects[ObjectIdx] : nullptr;
+			}
+			return *this;
+		}
+	private:
+		TArray<UObject*>& Objects;
+	};
+
+	void Write(const UObject* Root, const TArray<UXD_ActionDispatcherBase*>& Dispatchers, TArray<uint8>& OutData)
+	{
+		// 外部对象排在子对象之前，还原时可以按顺序创建
+		TArray<UObject*> Objects;
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Objects.Add(Dispatcher);
+			TArray<UObject*> SubObjects;
+			GetObjectsWithOuter(Dispatcher, SubObjects, true, RF_Transient);
+			auto GetDepth = [Dispatcher](const UObject& Object)
+			{
+				int32 Depth = 0;
+				for (const UObject* Outer = Object.GetOuter(); Outer != Dispatcher; Outer = Outer->GetOuter())
+				{
+					++Depth;
+				}
+				return Depth;
+			};
+			SubObjects.StableSort([&](const UObject& LHS, const UObject& RHS) { return GetDepth(LHS) < GetDepth(RHS); });
+			Objects.Append(SubObjects);
+		}
+
+		FMemoryWriter Writer(OutData, true);
+		FRecordArchive Ar(Writer, Objects);
+		int32 ObjectNum = Objects.Num();
+		Ar << ObjectNum;
+		for (UObject* Object : Objects)
+		{
+			FString ClassPath = Object->GetClass()->GetPathName();
+			int32 OuterIdx = Objects.IndexOfByKey(Object->GetOuter());
+			check(OuterIdx != INDEX_NONE || Object->GetOuter() == Root);
+			FName ObjectName = Object->GetFName();
+			Ar << ClassPath << OuterIdx << ObjectName;
+		}
+		// 记录每个对象数据的长度，类无法加载时跳过
+		for (UObject* Object : Objects)
+		{
+			const int64 SizePos = Writer.Tell();
+			int64 Size = 0;
+			Writer << Size;
+			Object->Serialize(Ar);
+			const int64 EndPos = Writer.Tell();
+			Size = EndPos - SizePos - sizeof(int64);
+			Writer.Seek(SizePos);
+			Writer << Size;
+			Writer.Seek(EndPos);
+		}
+	}
+
+	void Read(UObject* Root, const TArray<uint8>& Data, TArray<UXD_ActionDispatcherBase*>& OutDispatchers)
+	{
+		TArray<UObject*> Objects;
+		FMemoryReader Reader(Data, true);
+		FRecordArchive Ar(Reader, Objects);
+		int32 ObjectNum = 0;
+		Ar << ObjectNum;
+		Objects.Reserve(ObjectNum);
+		for (int32 Idx = 0; Idx < ObjectNum; ++Idx)
+		{
+			FString ClassPath;
+			int32 OuterIdx;
+			FName ObjectName;
+			Ar << ClassPath << OuterIdx << ObjectName;
+
+			UClass* Class = LoadObject<UClass>(nullptr, *ClassPath);
+			UObject* Outer = OuterIdx == INDEX_NONE ? Root : Objects[OuterIdx];
+			UObject* Object = nullptr;
+			if (Class && Outer)
+			{
+				// 重名时由引擎分配新的名字
+				Object = NewObject<UObject>(Outer, Class, StaticFindObjectFast(nullptr, Outer, ObjectName) ? NAME_None : ObjectName);
+				if (OuterIdx == INDEX_NONE)
+				{
+					if (UXD_ActionDispatcherBase* Dispatcher = Cast<UXD_ActionDispatcherBase>(Object))
+					{
+						OutDispatchers.Add(Dispatcher);
+					}
+				}
+			}
+			else
+			{
+				ActionDispatcher_Error_Log("还原调度器时无法创建%s", *ClassPath);
+			}
+			Objects.Add(Object);
+		}
+		for (UObject* Object : Objects)
+		{
+			int64 Size = 0;
+			Reader << Size;
+			if (Object)
+			{
+				Object->Serialize(Ar);
+			}
+			else
+			{
+				Reader.Seek(Reader.Tell() + Size);
+			}
+		}
+	}
+}
+
+bool UXD_ActionDispatcherManager::CanUnloadWithLevel(const UXD_ActionDispatcherBase* Dispatcher) const
+{
+	// 运行时绑定的委托无法序列化，保留在内存中
+	const UXD_ActionDispatcherExtraState* ExtraState = Dispatcher->GetExtraState();
+	return IsPendingDispatcher(Dispatcher) && Dispatcher->ReferencedLevels.Num() == 1 && Dispatcher->GetOuter() == this && Dispatcher->ActionDispatcherLeader == nullptr
+		&& Dispatcher->OnDispatchFinished.IsBound() == false && Dispatcher->WhenDispatchFinishedNative.IsBound() == false && Dispatcher->OnDispatchDeactiveNative.IsBound() == false
+		&& (ExtraState == nullptr || ExtraState->OnDispatcherAbortedNative.IsBound() == false);
+}
+
+void UXD_ActionDispatcherManager::UnloadLevelDispatchers(const FName& LevelName)
+{
+	const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>* LevelDispatcherList = LevelDispatchers.Find(LevelName);
+	if (LevelDispatcherList == nullptr)
+	{
+		return;
+	}
+	TArray<UXD_ActionDispatcherBase*> Dispatchers = GetLiveDispatchers(*LevelDispatcherList).FilterByPredicate([this](const UXD_ActionDispatcherBase* Dispatcher) { return CanUnloadWithLevel(Dispatcher); });
+	if (Dispatchers.Num() == 0)
+	{
+		return;
+	}
+
+	FActionDispatcherLevelRecord& Record = UnloadedLevelRecords.AddDefaulted_GetRef();
+	Record.LevelName = LevelName;
+	ActionDispatcherLevelRecord::Write(this, Dispatchers, Record.Data);
+	for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+	{
+		RemovePendingDispatcher(Dispatcher);
+		UnregisterDispatcherReferences(Dispatcher);
+		ReleaseAllEntities(Dispatcher);
+		// 移出管理器让出名字，还原时可以使用原来的名字
+		Dispatcher->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_ForceNoResetLoaders | REN_NonTransactional);
+		Dispatcher->MarkPendingKill();
+	}
+	ActionDispatcher_Display_Log("关卡%s卸载，序列化%d个调度器，共%d字节", *LevelName.ToString(), Dispatchers.Num(), Record.Data.Num());
+}
+
+void UXD_ActionDispatcherManager::RestoreLevelDispatchers(const FName& LevelName)
+{
+	TArray<UXD_ActionDispatcherBase*> Dispatchers;
+	for (int32 Idx = UnloadedLevelRecords.Num() - 1; Idx >= 0; --Idx)
+	{
+		if (UnloadedLevelRecords[Idx].LevelName == LevelName)
 		{
-			++i;
+			ActionDispatcherLevelRecord::Read(this, UnloadedLevelRecords[Idx].Data, Dispatchers);
+			UnloadedLevelRecords.RemoveAtSwap(Idx);
 		}
 	}
+	if (Dispatchers.Num() == 0)
+	{
+		return;
+	}
+
+	Dispatchers.StableSort([](const UXD_ActionDispatcherBase& LHS, const UXD_ActionDispatcherBase& RHS) { return LHS.Priority > RHS.Priority; });
+	for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+	{
+		RegisterDispatcherReferences(Dispatcher);
+	}
+	AddPendingDispatchers(Dispatchers);
+	ActionDispatcher_Display_Log("关卡%s加载，还原%d个调度器", *LevelName.ToString(), Dispatchers.Num());
 }
 
 void UXD_ActionDispatcherManager::TryActivePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher)
@@ -250,26 +844,434 @@ void UXD_ActionDispatcherManager::TryActivePendingDispatcher(UXD_ActionDispatche
 	bool bCanActive = Dispatcher->IsDispatcherStarted() ? Dispatcher->CanReactiveDispatcher() : Dispatcher->CanStartDispatcher();
 	if (bCanActive)
 	{
-		int32 Idx = PendingDispatchers.IndexOfByKey(Dispatcher);
-
-		check(Idx != INDEX_NONE);
-
-		if (Idx < ActivePendingActionIdx)
-		{
-			ActivePendingActionIdx -= 1;
-		}
+		// 等待队列中留空，不影响轮询位置
+		RemovePendingDispatcher(Dispatcher);
 
+		// 先加入激活列表，启动时被占用的实体阻塞会同步中断调度器并移回等待队列
 		if (Dispatcher->IsDispatcherStarted())
 		{
-			Dispatcher->ReactiveDispatcher();
-			PendingDispatchers.RemoveAt(Idx);
 			WhenDispatcherReactived(Dispatcher);
+			Dispatcher->ReactiveDispatcher();
 		}
 		else
 		{
-			Dispatcher->StartDispatch();
-			PendingDispatchers.RemoveAt(Idx);
 			WhenDispatcherStarted(Dispatcher);
+			Dispatcher->StartDispatch();
+		}
+	}
+	else
+	{
+		EnqueueLeaseWaiter(Dispatcher);
+	}
+}
+
+void UXD_ActionDispatcherManager::RegisterDispatcherReferences(UXD_ActionDispatcherBase* Dispatcher, TSet<FSoftObjectPath>* OutPaths)
+{
+	TArray<FSoftObjectPath> Paths;
+	Dispatcher->GetSoftReferencePaths(Paths);
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		EntityReferences.FindOrAdd(Path).Dispatchers.AddUnique(Dispatcher);
+		// 只按关卡中的Actor分组
+		if (Path.GetSubPathString().StartsWith(TEXT("PersistentLevel.")))
+		{
+			const FName LevelName = *Path.GetLongPackageName();
+			if (Dispatcher->ReferencedLevels.Contains(LevelName) == false)
+			{
+				Dispatcher->ReferencedLevels.Add(LevelName);
+				LevelDispatchers.FindOrAdd(LevelName).Add(Dispatcher);
+			}
+		}
+	}
+	if (OutPaths)
+	{
+		OutPaths->Append(Paths);
+	}
+}
+
+void UXD_ActionDispatcherManager::UnregisterDispatcherReferences(UXD_ActionDispatcherBase* Dispatcher)
+{
+	TArray<FSoftObjectPath> Paths;
+	Dispatcher->GetSoftReferencePaths(Paths);
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		if (FDispatcherEntityReference* Reference = EntityReferences.Find(Path))
+		{
+			RemoveIndexedDispatcher(Reference->Dispatchers, Dispatcher);
+			if (Reference->Dispatchers.Num() == 0)
+			{
+				EntityToPath.Remove(Reference->EntityKey);
+				EntityReferences.Remove(Path);
+			}
+		}
+	}
+	for (const FName& LevelName : Dispatcher->ReferencedLevels)
+	{
+		if (TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>* Dispatchers = LevelDispatchers.Find(LevelName))
+		{
+			RemoveIndexedDispatcher(*Dispatchers, Dispatcher);
+			if (Dispatchers->Num() == 0)
+			{
+				LevelDispatchers.Remove(LevelName);
+			}
+		}
+	}
+	Dispatcher->ReferencedLevels.Reset();
+}
+
+void UXD_ActionDispatcherManager::RebuildEntityReferences()
+{
+	EntityReferences.Reset();
+	EntityToPath.Reset();
+	LevelDispatchers.Reset();
+	for (UXD_ActionDispatcherBase* Dispatcher : ActivedDispatchers)
+	{
+		Dispatcher->ReferencedLevels.Reset();
+	}
+	for (UXD_ActionDispatcherBase* Dispatcher : PendingDispatchers)
+	{
+		if (Dispatcher)
+		{
+			Dispatcher->ReferencedLevels.Reset();
+		}
+	}
+	for (UXD_ActionDispatcherBase* Dispatcher : ActivedDispatchers)
+	{
+		RegisterDispatcherReferences(Dispatcher);
+	}
+	for (UXD_ActionDispatcherBase* Dispatcher : PendingDispatchers)
+	{
+		if (Dispatcher)
+		{
+			RegisterDispatcherReferences(Dispatcher);
+		}
+	}
+}
+
+void UXD_ActionDispatcherManager::SetReferencedEntity(FDispatcherEntityReference& Reference, const FSoftObjectPath& Path, UObject* Entity)
+{
+	EntityToPath.Remove(Reference.EntityKey);
+	Reference.Entity = Entity;
+	Reference.EntityKey = Entity;
+	if (Entity)
+	{
+		EntityToPath.Add(Entity, Path);
+	}
+}
+
+UObject* UXD_ActionDispatcherManager::ResolveSoftReference(const FSoftObjectPath& Path)
+{
+	FDispatcherEntityReference* Reference = EntityReferences.Find(Path);
+	if (Reference == nullptr)
+	{
+		return Path.ResolveObject();
+	}
+	if (UObject* Entity = Reference->Entity.Get())
+	{
+		return Entity;
+	}
+	UObject* Entity = Path.ResolveObject();
+	if (Entity || Reference->EntityKey != TObjectKey<UObject>())
+	{
+		SetReferencedEntity(*Reference, Path, Entity);
+	}
+	return Entity;
+}
+
+TArray<UXD_ActionDispatcherBase*> UXD_ActionDispatcherManager::GetDispatchersReferencing(const UObject* Entity) const
+{
+	if (const FSoftObjectPath* Path = EntityToPath.Find(Entity))
+	{
+		return GetLiveDispatchers(EntityReferences.FindChecked(*Path).Dispatchers);
+	}
+	return {};
+}
+
+TArray<UXD_ActionDispatcherBase*> UXD_ActionDispatcherManager::GetLiveDispatchers(const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Dispatchers)
+{
+	TArray<UXD_ActionDispatcherBase*> LiveDispatchers;
+	LiveDispatchers.Reserve(Dispatchers.Num());
+	for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Dispatcher : Dispatchers)
+	{
+		if (UXD_ActionDispatcherBase* LiveDispatcher = Dispatcher.Get())
+		{
+			LiveDispatchers.Add(LiveDispatcher);
 		}
 	}
+	return LiveDispatchers;
+}
+
+void UXD_ActionDispatcherManager::RemoveIndexedDispatcher(TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Dispatchers, const UXD_ActionDispatcherBase* Dispatcher)
+{
+	// 顺带清理已被回收的调度器，注销时调度器可能已标记为PendingKill，按弱指针的对象序号比较
+	const TWeakObjectPtr<UXD_ActionDispatcherBase> Key(Dispatcher);
+	Dispatchers.RemoveAllSwap([&](const TWeakObjectPtr<UXD_ActionDispatcherBase>& E) { return E.HasSameIndexAndSerialNumber(Key) || E.IsStale(); });
+}
+
+void UXD_ActionDispatcherManager::WakeDispatchersReferencing(const UObject* Entity)
+{
+	// 激活的调度器可能直接结束导致索引改变，先复制一份
+	for (UXD_ActionDispatcherBase* Dispatcher : GetDispatchersReferencing(Entity))
+	{
+		TryWakePendingDispatcher(Dispatcher);
+	}
+}
+
+void UXD_ActionDispatcherManager::AbortDispatchersReferencing(const UObject* Entity)
+{
+	for (UXD_ActionDispatcherBase* Dispatcher : GetDispatchersReferencing(Entity))
+	{
+		if (Dispatcher->State == EActionDispatcherState::Active)
+		{
+			ActionDispatcher_Display_Log("因实体%s导致%s中断", *UXD_DebugFunctionLibrary::GetDebugName(Entity), *UXD_DebugFunctionLibrary::GetDebugName(Dispatcher));
+			Dispatcher->AbortDispatch();
+		}
+	}
+}
+
+const UXD_ActionDispatcherBase* UXD_ActionDispatcherManager::GetFirstLeaseWaiter(const FDispatcherEntityLease& Lease)
+{
+	// 已在执行的调度器不再等待
+	for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter : Lease.Waiters)
+	{
+		if (Waiter.IsValid() && Waiter->State == EActionDispatcherState::Deactive)
+		{
+			return Waiter.Get();
+		}
+	}
+	return nullptr;
+}
+
+void UXD_ActionDispatcherManager::SetLeaseExpireTimer(const UObject* Entity, FDispatcherEntityLease& Lease, float Duration)
+{
+	ActionTimerWheel.Cancel(Lease.ExpireTimerHandle);
+	if (Duration > 0.f)
+	{
+		Lease.ExpireTimerHandle = ActionTimerWheel.ScheduleLease(Entity, Duration);
+	}
+}
+
+void UXD_ActionDispatcherManager::WhenLeaseExpired(TObjectKey<UObject> Entity)
+{
+	// 续租与释放时会取消之前的定时器，到期回调只来自当前租约
+	FDispatcherEntityLease* Lease = EntityLeases.Find(Entity);
+	if (Lease == nullptr)
+	{
+		return;
+	}
+	Lease->ExpireTimerHandle.Invalidate();
+	Lease->Holder.Reset();
+
+	Lease->Waiters.RemoveAll([](const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter) { return Waiter.IsValid() == false || Waiter->State != EActionDispatcherState::Deactive; });
+	const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>> Waiters = Lease->Waiters;
+	if (Waiters.Num() == 0)
+	{
+		EntityLeases.Remove(Entity);
+	}
+	WakeLeaseWaiters(Waiters);
+}
+
+void UXD_ActionDispatcherManager::SaveEntityLeases()
+{
+	EntityLeaseRecords.Reset();
+	for (const TPair<TObjectKey<UObject>, FDispatcherEntityLease>& Pair : EntityLeases)
+	{
+		UObject* Entity = Pair.Key.ResolveObjectPtr();
+		const FDispatcherEntityLease& Lease = Pair.Value;
+		if (Entity == nullptr)
+		{
+			continue;
+		}
+
+		FDispatcherEntityLeaseRecord Record;
+		Record.Entity = Entity;
+		if (IsLeaseActive(Lease))
+		{
+			Record.Holder = Lease.Holder.Get();
+			// 与行为定时器一样保存剩余时间，读档后重新加入时间轮
+			Record.RemainingTime = Lease.ExpireTimerHandle.IsValid() ? FMath::Max(ActionTimerWheel.GetRemainingTime(Lease.ExpireTimerHandle), KINDA_SMALL_NUMBER) : 0.f;
+		}
+		for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter : Lease.Waiters)
+		{
+			if (Waiter.IsValid() && Waiter->State == EActionDispatcherState::Deactive)
+			{
+				Record.Waiters.Add(Waiter.Get());
+			}
+		}
+		if (Record.Holder || Record.Waiters.Num() > 0)
+		{
+			EntityLeaseRecords.Add(Record);
+		}
+	}
+}
+
+void UXD_ActionDispatcherManager::RestoreEntityLeases()
+{
+	for (TPair<TObjectKey<UObject>, FDispatcherEntityLease>& Pair : EntityLeases)
+	{
+		ActionTimerWheel.Cancel(Pair.Value.ExpireTimerHandle);
+	}
+	EntityLeases.Reset();
+	for (const FDispatcherEntityLeaseRecord& Record : EntityLeaseRecords)
+	{
+		UObject* Entity = ResolveSoftReference(Record.Entity.ToSoftObjectPath());
+		if (Entity == nullptr)
+		{
+			ActionDispatcher_Warning_LOG("读档时租约的实体%s不存在，放弃该租约", *Record.Entity.ToString());
+			continue;
+		}
+
+		FDispatcherEntityLease& Lease = EntityLeases.Add(Entity);
+		Lease.Holder = Record.Holder;
+		for (UXD_ActionDispatcherBase* Waiter : Record.Waiters)
+		{
+			if (Waiter)
+			{
+				Lease.Waiters.Add(Waiter);
+			}
+		}
+		if (Lease.Holder.IsValid())
+		{
+			SetLeaseExpireTimer(Entity, Lease, Record.RemainingTime);
+		}
+	}
+	EntityLeaseRecords.Empty();
+}
+
+void UXD_ActionDispatcherManager::TryWakePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher)
+{
+	if (Dispatcher && Dispatcher->State == EActionDispatcherState::Deactive && IsPendingDispatcher(Dispatcher))
+	{
+		TryActivePendingDispatcher(Dispatcher);
+	}
+}
+
+void UXD_ActionDispatcherManager::WakeLeaseWaiters(const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Waiters)
+{
+	// 按等待顺序尝试激活，先激活的调度器会取得租约
+	for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter : Waiters)
+	{
+		TryWakePendingDispatcher(Waiter.Get());
+	}
+}
+
+void UXD_ActionDispatcherManager::ReserveEntity(UXD_ActionDispatcherBase* Dispatcher, UObject* Entity, float Duration)
+{
+	check(Dispatcher && Entity);
+
+	FDispatcherEntityLease& Lease = EntityLeases.FindOrAdd(Entity);
+	if (Lease.Holder != Dispatcher && IsLeaseActive(Lease))
+	{
+		ActionDispatcher_Display_Log("%s抢占了%s对实体%s的租约", *UXD_DebugFunctionLibrary::GetDebugName(Dispatcher), *UXD_DebugFunctionLibrary::GetDebugName(Lease.Holder.Get()), *UXD_DebugFunctionLibrary::GetDebugName(Entity));
+	}
+	Lease.Holder = Dispatcher;
+	Lease.Waiters.Remove(Dispatcher);
+	SetLeaseExpireTimer(Entity, Lease, Duration);
+}
+
+void UXD_ActionDispatcherManager::ReleaseEntity(UXD_ActionDispatcherBase* Dispatcher, UObject* Entity)
+{
+	if (FDispatcherEntityLease* Lease = EntityLeases.Find(Entity))
+	{
+		Lease->Waiters.Remove(Dispatcher);
+		if (Lease->Holder == Dispatcher)
+		{
+			ActionTimerWheel.Cancel(Lease->ExpireTimerHandle);
+			const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>> Waiters = Lease->Waiters;
+			if (Waiters.Num() == 0)
+			{
+				EntityLeases.Remove(Entity);
+			}
+			else
+			{
+				Lease->Holder.Reset();
+			}
+			WakeLeaseWaiters(Waiters);
+		}
+	}
+}
+
+void UXD_ActionDispatcherManager::ReleaseAllEntities(UXD_ActionDispatcherBase* Dispatcher)
+{
+	TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>> Waiters;
+	for (auto It = EntityLeases.CreateIterator(); It; ++It)
+	{
+		FDispatcherEntityLease& Lease = It.Value();
+		Lease.Waiters.Remove(Dispatcher);
+		if (Lease.Holder == Dispatcher)
+		{
+			ActionTimerWheel.Cancel(Lease.ExpireTimerHandle);
+			Lease.Holder.Reset();
+			for (const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter : Lease.Waiters)
+			{
+				Waiters.AddUnique(Waiter);
+			}
+		}
+		if (Lease.Holder.IsValid() == false && Lease.Waiters.Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	WakeLeaseWaiters(Waiters);
+}
+
+bool UXD_ActionDispatcherManager::IsEntityLeasedByOther(const UXD_ActionDispatcherBase* Dispatcher, const UObject* Entity) const
+{
+	const FDispatcherEntityLease* Lease = EntityLeases.Find(Entity);
+	if (Lease == nullptr)
+	{
+		return false;
+	}
+
+	if (IsLeaseActive(*Lease))
+	{
+		const UXD_ActionDispatcherBase* Holder = Lease->Holder.Get();
+		// 与主调度器的抢占规则一致，只由抢占策略决定
+		return !(Holder == Dispatcher || Dispatcher->CanPreempt(Holder));
+	}
+
+	// 租约失效后按等待顺序使用实体
+	const UXD_ActionDispatcherBase* FirstWaiter = GetFirstLeaseWaiter(*Lease);
+	return FirstWaiter && FirstWaiter != Dispatcher;
+}
+
+void UXD_ActionDispatcherManager::EnqueueLeaseWaiter(UXD_ActionDispatcherBase* Dispatcher)
+{
+	// 被领导的调度器由领导者控制，不受租约限制
+	if (EntityLeases.Num() == 0 || Dispatcher->ActionDispatcherLeader)
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> Paths;
+	Dispatcher->GetSoftReferencePaths(Paths);
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		UObject* Entity = ResolveSoftReference(Path);
+		FDispatcherEntityLease* Lease = Entity ? EntityLeases.Find(Entity) : nullptr;
+		if (Lease == nullptr)
+		{
+			continue;
+		}
+
+		Lease->Waiters.RemoveAll([Dispatcher](const TWeakObjectPtr<UXD_ActionDispatcherBase>& Waiter) { return Waiter != Dispatcher && (Waiter.IsValid() == false || Waiter->State != EActionDispatcherState::Deactive); });
+		if (IsEntityLeasedByOther(Dispatcher, Entity))
+		{
+			if (Lease->Waiters.Contains(Dispatcher) == false)
+			{
+				Lease->Waiters.Add(Dispatcher);
+				INC_DWORD_STAT(STAT_ActionDispatcher_LeaseBlocked);
+			}
+		}
+		else if (IsLeaseActive(*Lease) == false && Lease->Waiters.Num() == 0)
+		{
+			EntityLeases.Remove(Entity);
+		}
+	}
+}
+
+UXD_ActionDispatcherBase* UXD_ActionDispatcherManager::GetEntityLeaseHolder(const UObject* Entity) const
+{
+	const FDispatcherEntityLease* Lease = EntityLeases.Find(Entity);
+	return Lease && IsLeaseActive(*Lease) ? Lease->Holder.Get() : nullptr;
 }
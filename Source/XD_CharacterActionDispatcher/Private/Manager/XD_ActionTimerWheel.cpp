@@ -0,0 +1,220 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Manager/XD_ActionTimerWheel.h"
+#include "Action/XD_DispatchableActionBase.h"
+
+FActionTimerWheel::FActionTimerWheel()
+	:CurrentTick(0), AccumulatedTime(0.f), Resolution(0.05f)
+{
+	for (int32& SlotHead : SlotHeads)
+	{
+		SlotHead = INDEX_NONE;
+	}
+}
+
+void FActionTimerWheel::SetResolution(float InResolution)
+{
+	// 已有定时器的到期时间以刻度记录，只能在空闲时修改
+	check(Num() == 0);
+	Resolution = FMath::Max(InResolution, KINDA_SMALL_NUMBER);
+}
+
+FActionTimerHandle FActionTimerWheel::Schedule(UXD_DispatchableActionBase* Action, EDispatchableActionTimerType Type, float Delay)
+{
+	FTimer* Timer;
+	const FActionTimerHandle Handle = AddTimer(Delay, Timer);
+	Timer->Action = Action;
+	Timer->Type = Type;
+	return Handle;
+}
+
+FActionTimerHandle FActionTimerWheel::ScheduleLease(const UObject* Entity, float Delay)
+{
+	FTimer* Timer;
+	const FActionTimerHandle Handle = AddTimer(Delay, Timer);
+	Timer->LeaseEntity = Entity;
+	Timer->bLease = true;
+	return Handle;
+}
+
+FActionTimerHandle FActionTimerWheel::AddTimer(float Delay, FTimer*& OutTimer)
+{
+	int32 TimerIndex;
+	if (FreeTimers.Num() > 0)
+	{
+		TimerIndex = FreeTimers.Pop(false);
+	}
+	else
+	{
+		TimerIndex = Timers.AddDefaulted();
+	}
+
+	// 至少等待一个刻度，已累积的时间计入当前刻度，超出时间轮范围的按最大延迟处理
+	const double DelayTicks = FMath::Clamp<double>(FMath::CeilToDouble((Delay + AccumulatedTime) / Resolution), 1.0, (double)MaxDelayTicks);
+
+	FTimer& Timer = Timers[TimerIndex];
+	Timer.ExpireTick = CurrentTick + (uint64)DelayTicks;
+	LinkTimer(TimerIndex);
+	OutTimer = &Timer;
+
+	FActionTimerHandle Handle;
+	Handle.Index = TimerIndex;
+	Handle.Serial = Timer.Serial;
+	return Handle;
+}
+
+void FActionTimerWheel::Cancel(FActionTimerHandle& Handle)
+{
+	if (FindTimer(Handle))
+	{
+		UnlinkTimer(Handle.Index);
+		FreeTimer(Handle.Index);
+	}
+	Handle.Invalidate();
+}
+
+bool FActionTimerWheel::IsActive(const FActionTimerHandle& Handle) const
+{
+	return FindTimer(Handle) != nullptr;
+}
+
+float FActionTimerWheel::GetRemainingTime(const FActionTimerHandle& Handle) const
+{
+	if (const FTimer* Timer = FindTimer(Handle))
+	{
+		return FMath::Max((Timer->ExpireTick - CurrentTick) * Resolution - AccumulatedTime, 0.f);
+	}
+	return -1.f;
+}
+
+void FActionTimerWheel::Advance(float DeltaTime, TFunctionRef<void(UXD_DispatchableActionBase*, EDispatchableActionTimerType)> OnFired, TFunctionRef<void(TObjectKey<UObject>)> OnLeaseExpired)
+{
+	AccumulatedTime += DeltaTime;
+	if (Num() == 0)
+	{
+		// 没有定时器时不需要逐个刻度推进
+		const uint64 ElapsedTicks = (uint64)(AccumulatedTime / Resolution);
+		CurrentTick += ElapsedTicks;
+		AccumulatedTime -= ElapsedTicks * Resolution;
+		return;
+	}
+
+	TArray<FTimer> FiredTimers;
+	while (AccumulatedTime >= Resolution)
+	{
+		AccumulatedTime -= Resolution;
+		CurrentTick += 1;
+
+		// 低层转完一圈时下放高层的槽，下放的定时器可能在当前刻度到期，需要先于到期处理
+		if ((CurrentTick & SlotMask) == 0)
+		{
+			for (int32 Level = 1; Level < LevelNum; ++Level)
+			{
+				const int32 SlotIdx = (CurrentTick >> (Level * SlotBits)) & SlotMask;
+				CascadeSlot(Level * SlotNum + SlotIdx);
+				if (SlotIdx != 0)
+				{
+					break;
+				}
+			}
+		}
+
+		const int32 Slot = CurrentTick & SlotMask;
+		for (int32 TimerIndex = SlotHeads[Slot]; TimerIndex != INDEX_NONE;)
+		{
+			const int32 NextIndex = Timers[TimerIndex].Next;
+			FiredTimers.Add(Timers[TimerIndex]);
+			FreeTimer(TimerIndex);
+			TimerIndex = NextIndex;
+		}
+		SlotHeads[Slot] = INDEX_NONE;
+	}
+
+	for (const FTimer& FiredTimer : FiredTimers)
+	{
+		if (FiredTimer.bLease)
+		{
+			OnLeaseExpired(FiredTimer.LeaseEntity);
+		}
+		else if (UXD_DispatchableActionBase* Action = FiredTimer.Action.Get())
+		{
+			OnFired(Action, FiredTimer.Type);
+		}
+	}
+}
+
+const FActionTimerWheel::FTimer* FActionTimerWheel::FindTimer(const FActionTimerHandle& Handle) const
+{
+	if (Timers.IsValidIndex(Handle.Index))
+	{
+		const FTimer& Timer = Timers[Handle.Index];
+		if (Timer.Serial == Handle.Serial && Timer.Slot != INDEX_NONE)
+		{
+			return &Timer;
+		}
+	}
+	return nullptr;
+}
+
+void FActionTimerWheel::LinkTimer(int32 TimerIndex)
+{
+	FTimer& Timer = Timers[TimerIndex];
+	const uint64 DelayTicks = Timer.ExpireTick - CurrentTick;
+	int32 Level = 0;
+	while (Level < LevelNum - 1 && DelayTicks >= (uint64(1) << ((Level + 1) * SlotBits)))
+	{
+		Level += 1;
+	}
+	const int32 Slot = Level * SlotNum + ((Timer.ExpireTick >> (Level * SlotBits)) & SlotMask);
+
+	Timer.Slot = Slot;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = SlotHeads[Slot];
+	if (Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = TimerIndex;
+	}
+	SlotHeads[Slot] = TimerIndex;
+}
+
+void FActionTimerWheel::UnlinkTimer(int32 TimerIndex)
+{
+	FTimer& Timer = Timers[TimerIndex];
+	if (Timer.Prev != INDEX_NONE)
+	{
+		Timers[Timer.Prev].Next = Timer.Next;
+	}
+	else
+	{
+		SlotHeads[Timer.Slot] = Timer.Next;
+	}
+	if (Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = Timer.Prev;
+	}
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+}
+
+void FActionTimerWheel::FreeTimer(int32 TimerIndex)
+{
+	FTimer& Timer = Timers[TimerIndex];
+	Timer.Action.Reset();
+	Timer.LeaseEntity = TObjectKey<UObject>();
+	Timer.bLease = false;
+	Timer.Slot = INDEX_NONE;
+	Timer.Serial += 1;
+	FreeTimers.Add(TimerIndex);
+}
+
+void FActionTimerWheel::CascadeSlot(int32 Slot)
+{
+	int32 TimerIndex = SlotHeads[Slot];
+	SlotHeads[Slot] = INDEX_NONE;
+	while (TimerIndex != INDEX_NONE)
+	{
+		const int32 NextIndex = Timers[TimerIndex].Next;
+		LinkTimer(TimerIndex);
+		TimerIndex = NextIndex;
+	}
+}
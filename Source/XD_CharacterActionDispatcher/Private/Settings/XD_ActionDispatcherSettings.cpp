@@ -10,4 +10,12 @@ UXD_ActionDispatcherSettings::UXD_ActionDispatcherSettings()
 	bShowPluginNode = true;
 	bShowPluginClass = true;
 #endif
+
+	PendingEvaluateBatchNum = 256;
+	ParallelEvaluateMinNum = 64;
+	ActivePendingTimeLimit = 0.001f;
+	BulkStartTimeLimit = 0.002f;
+	bUnloadDispatchersWithLevel = false;
+	ActionTimerResolution = 0.05f;
+	bEnableActionWatchdog = true;
 }
@@ -0,0 +1,10 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Utils/XD_ActionDispatcher_Stats.h"
+
+DEFINE_STAT(STAT_ActionDispatcher_Abort);
+DEFINE_STAT(STAT_ActionDispatcher_Reactive);
+DEFINE_STAT(STAT_ActionDispatcher_LeaseBlocked);
+DEFINE_STAT(STAT_ActionDispatcher_WatchdogStuck);
+DEFINE_STAT(STAT_ActionDispatcher_WatchdogRecovered);
+DEFINE_STAT(STAT_ActionDispatcher_WatchdogAborted);
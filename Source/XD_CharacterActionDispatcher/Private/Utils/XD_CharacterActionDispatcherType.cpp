@@ -1,3 +1,44 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Utils/XD_CharacterActionDispatcherType.h"
+#include "Dispatcher/XD_ActionDispatcherBase.h"
+#include "Utils/XD_ActionDispatcher_Log.h"
+#include "XD_DebugFunctionLibrary.h"
+
+void FDispatchableActionEventBase::BindNativeState(UXD_ActionDispatcherBase* Dispatcher, int32 StateIndex)
+{
+	NativeDispatcher = Dispatcher;
+	NativeState = StateIndex;
+	Dispatcher->GetNativeStateNode(StateIndex, NativeNodeGuid, NativePinIndex);
+}
+
+void FDispatchableActionEventBase::ExecuteEvent() const
+{
+	if (NativeState == INDEX_NONE && NativeNodeGuid.IsValid() == false)
+	{
+		Event.ExecuteIfBound();
+		return;
+	}
+
+	UXD_ActionDispatcherBase* Dispatcher = NativeDispatcher.Get();
+	if (Dispatcher == nullptr)
+	{
+		return;
+	}
+	// 读档后只有目标节点，按节点查找当前状态表中的状态
+	const int32 StateIndex = NativeState != INDEX_NONE ? NativeState : Dispatcher->FindNativeState(NativeNodeGuid, NativePinIndex);
+	if (StateIndex != INDEX_NONE)
+	{
+		Dispatcher->EnterNativeState(StateIndex);
+	}
+	else if (Event.IsBound())
+	{
+		Event.Execute();
+	}
+	else
+	{
+		// 状态表已关闭或节点已删除，无法继续执行
+		ActionDispatcher_Error_Log("%s的状态表中不存在节点%s，中断调度器", *UXD_DebugFunctionLibrary::GetDebugName(Dispatcher), *NativeNodeGuid.ToString());
+		Dispatcher->AbortDispatch();
+	}
+}
@@ -22,12 +22,8 @@ public:
 	TSet<AActor*> GetAllRegistableEntities() const override { return {}; }
 	bool IsActionValid() const override;
 	void WhenActionActived() override;
-	void WhenActionDeactived() override;
+	void WhenActionTimerFired() override;
 public:
-	FTimerHandle TimerHandle;
-
 	UPROPERTY(BlueprintReadOnly, Category = "例子", meta = (ExposeOnSpawn = "true"), SaveGame)
 	float DelayTime;
-
-	void WhenTimeFinished();
 };
@@ -25,6 +25,7 @@ public:
 	void WhenActionActived() override;
 	void WhenActionDeactived() override;
 	void WhenActionFinished() override;
+	bool RecoverStuckAction() override;
 
 protected:
 	UPROPERTY(SaveGame, BlueprintReadWrite, meta = (DisplayName = "当到达了"))
@@ -34,6 +35,15 @@ protected:
 	FOnDispatchableActionFinishedEvent WhenCanNotReached;
 
 	void WhenRequestFinished(FAIRequestID RequestID, const FPathFollowingResult& Result);
+public:
+	// 由实体通过AD_RequestMoveTo接管的移动结束时调用
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	void FinishMoveRequest(bool bSucceeded);
+private:
+	// 移动由实体处理，不需要AIController
+	uint8 bIsEntityMoveRequest : 1;
+
+	void StopMove(APawn* Mover);
 public:
 	UPROPERTY(SaveGame, BlueprintReadOnly, meta = (ExposeOnSpawn = "true"))
 	TSoftObjectPtr<APawn> Pawn;
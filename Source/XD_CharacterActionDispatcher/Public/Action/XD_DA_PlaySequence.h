@@ -63,6 +63,8 @@ public:
 	void WhenActionActived() override;
 	void WhenActionDeactived() override;
 	void WhenActionFinished() override;
+	void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+	bool RecoverStuckAction() override;
 
 	UPROPERTY(SaveGame, BlueprintReadWrite, meta = (DisplayName = "播放完毕"))
 	FOnDispatchableActionFinishedEvent WhenPlayCompleted;
@@ -0,0 +1,30 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Action/XD_DispatchableActionBase.h"
+#include "XD_DA_Wait.generated.h"
+
+/**
+ * 等待一段时间后执行事件，由管理器的时间轮驱动，读档后继续等待剩余的时间
+ */
+UCLASS(meta = (DisplayName = "等待"))
+class XD_CHARACTERACTIONDISPATCHER_API UXD_DA_Wait : public UXD_DispatchableActionBase
+{
+	GENERATED_BODY()
+public:
+	UXD_DA_Wait();
+
+	UPROPERTY(SaveGame, BlueprintReadWrite, meta = (DisplayName = "当等待结束时"))
+	FOnDispatchableActionFinishedEvent OnWaitFinished;
+
+	UPROPERTY(BlueprintReadOnly, Category = "等待", meta = (DisplayName = "等待时间", ExposeOnSpawn = "true"), SaveGame)
+	float Duration;
+
+	TSet<AActor*> GetAllRegistableEntities() const override { return {}; }
+	bool IsActionValid() const override { return true; }
+	void WhenActionActived() override;
+	void WhenActionReactived() override;
+	void WhenActionTimerFired() override;
+};
@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include <UObject/NoExportTypes.h>
 #include "Utils/XD_CharacterActionDispatcherType.h"
+#include "Manager/XD_ActionTimerWheel.h"
 #include "XD_DispatchableActionBase.generated.h"
 
 class UXD_ActionDispatcherBase;
@@ -32,10 +33,11 @@ public:
 protected:
 	friend class UXD_ActionDispatcherBase;
 
-	void ActiveAction();
+	// 实体被无法抢占的调度器占用时不激活，返回false
+	bool ActiveAction();
 	void AbortAction();
 	void DeactiveAction();
-	void ReactiveAction();
+	bool ReactiveAction();
 protected:
 	//当行为被第一次激活时的实现
 	virtual void WhenActionActived(){}
@@ -54,8 +56,58 @@ protected:
 
 	UPROPERTY(EditDefaultsOnly, Category = "设置")
 	uint8 bTickable : 1;
-	//需开启bTickable
+
+	// 默认占用全部通道，与任何行为都不兼容
+	UPROPERTY(EditDefaultsOnly, Category = "设置", meta = (DisplayName = "占用通道", Bitmask, BitmaskEnum = "EDispatchableActionChannel"))
+	uint8 OccupiedChannels;
+public:
+	// 占用通道不重叠时两个行为可在同一实体上同时执行，忽略旧资源中未声明的通道位
+	bool IsCompatibleWith(const UXD_DispatchableActionBase* Other) const { return (OccupiedChannels & Other->OccupiedChannels & (uint8)EDispatchableActionChannel::All) == 0; }
+protected:
+	//需开启bTickable，需要等待时使用SetActionTimer
 	virtual void WhenTick(float DeltaSeconds) {}
+public:
+	// 大于0时行为激活超过该时间后调用WhenActionTimeout，默认中断调度器
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AdvancedDisplay, SaveGame, Category = "设置", meta = (DisplayName = "超时时间", ExposeOnSpawn = "true"))
+	float TimeoutSeconds;
+protected:
+	virtual void WhenActionTimeout();
+
+	// 由管理器的时间轮驱动，每个行为一个定时器，重复设置时覆盖，存档时保留剩余时间
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	void SetActionTimer(float Delay);
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	void ClearActionTimer();
+	UFUNCTION(BlueprintPure, Category = "行为")
+	bool IsActionTimerActive() const;
+	virtual void WhenActionTimerFired() {}
+
+	// 行为执行超过该时长时视为卡住，小于等于0时不检查
+	UPROPERTY(EditDefaultsOnly, Category = "看门狗", meta = (DisplayName = "预期时长"))
+	float WatchdogDuration;
+
+	UPROPERTY(EditDefaultsOnly, Category = "看门狗", meta = (DisplayName = "卡住时的处理"))
+	EDispatchableActionWatchdogPolicy WatchdogPolicy;
+
+	// 卡住时的恢复处理，返回false时行为保持执行
+	virtual bool RecoverStuckAction() { return false; }
+private:
+	friend class UXD_ActionDispatcherManager;
+	void WhenTimerFired(EDispatchableActionTimerType Type);
+	void WhenWatchdogFired();
+
+	// 剩余时间在存档与反激活时记录，再次激活时恢复，小于等于0时没有定时器
+	UPROPERTY(SaveGame)
+	float TimerRemainingTimes[ActionTimerTypeNum];
+
+	FActionTimerHandle TimerHandles[ActionTimerTypeNum];
+	// 看门狗已报告的次数
+	int32 WatchdogReportNum;
+
+	void ScheduleTimer(EDispatchableActionTimerType Type, float Delay);
+	void SaveTimerRemainingTime();
+	bool HasAnyTimer() const;
+	void CancelTimers();
 private:
 	void FinishAction();
 public:
@@ -81,10 +133,15 @@ public:
 protected:
 	//返回行为中所有需要注册的实体
 	virtual TSet<AActor*> GetAllRegistableEntities() const;
+public:
+	//返回占用了该行为实体且无法被抢占的调度器
+	UXD_ActionDispatcherBase* FindBlockingDispatcher() const;
 private:
-	//所有执行Action的实体在Active时注册
+	//所有执行Action的实体在Active时注册，实体被无法抢占的调度器占用时不注册并返回false
 	UFUNCTION(BlueprintCallable, Category = "行为")
-	void RegisterEntity(AActor* Actor);
+	bool RegisterEntity(AActor* Actor);
+	// 注册所有实体，失败时撤销已注册的实体
+	bool RegisterAllEntities();
 	//所有执行Action的实体在Finish时反注册
 	UFUNCTION(BlueprintCallable, Category = "行为")
 	void UnregisterEntity(AActor* Actor);
@@ -141,4 +198,8 @@ public:
 	void WhenSaveState() override { ReceiveWhenSaveState(); }
 	UFUNCTION(BlueprintImplementableEvent, Category = "行为", meta = (DisplayName = "WhenSaveState"))
 	void ReceiveWhenSaveState();
+
+	void WhenActionTimerFired() override { ReceiveWhenActionTimerFired(); }
+	UFUNCTION(BlueprintImplementableEvent, Category = "行为", meta = (DisplayName = "WhenActionTimerFired"))
+	void ReceiveWhenActionTimerFired();
 };
@@ -20,11 +20,19 @@ public:
 	UClass* GetBlueprintClass() const override;
 	void GetReparentingRules(TSet<const UClass*>& AllowedChildrenOfClasses, TSet<const UClass*>& DisallowedChildrenOfClasses) const override;
 	bool AlwaysCompileOnLoad() const override { return Status == EBlueprintStatus::BS_Dirty; }
+	void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
+
+	// 资源注册表中记录结束事件的标签，值为逗号分隔的Tag，引用该调度器的节点无需加载调度器类
+	static FName GetFinishTagsRegistryName() { return TEXT("ActionDispatcherFinishTags"); }
 
 	UPROPERTY()
 	UObject* WhenDispatchStartNode;
 
 	UPROPERTY()
 	TArray<FName> FinishTags;
+
+	// 将仅由行为、共同事件与结束调度构成的部分编译为原生状态表，行为事件跳转不再经过蓝图虚拟机
+	UPROPERTY(EditAnywhere, Category = "行为调度器", meta = (DisplayName = "编译原生状态表"))
+	uint8 bCompileNativeStateTable : 1;
 #endif
 };
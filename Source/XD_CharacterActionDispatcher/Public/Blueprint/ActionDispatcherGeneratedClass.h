@@ -4,10 +4,125 @@
 
 #include "CoreMinimal.h"
 #include <Engine/BlueprintGeneratedClass.h>
+#include <GameplayTagContainer.h>
 #include "ActionDispatcherGeneratedClass.generated.h"
 
+class UXD_DispatchableActionBase;
+
+UENUM()
+enum class EActionDispatcherNodeType : uint8
+{
+	Action,
+	TogetherFlowControl,
+	SubActionDispatcher
+};
+
+USTRUCT()
+struct FActionDispatcherNodeData
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	FGuid NodeGuid;
+
+	UPROPERTY()
+	EActionDispatcherNodeType NodeType = EActionDispatcherNodeType::Action;
+
+	// 同类型节点中的序号
+	UPROPERTY()
+	int32 TypeIndex = INDEX_NONE;
+
+	// 共同事件的输入数量
+	UPROPERTY()
+	int32 TogetherCount = 0;
+};
+
+UENUM()
+enum class EActionDispatcherNativeStateType : uint8
+{
+	ExecuteAction,
+	FinishDispatch,
+	// 共同事件的每个输入为一个状态
+	Together
+};
+
+// 行为属性的赋值，SourceMemberName不为空时拷贝调度器的成员变量，否则导入ValueText
+USTRUCT()
+struct FActionDispatcherNativeParam
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	FName PropertyName;
+
+	UPROPERTY()
+	FName SourceMemberName;
+
+	UPROPERTY()
+	FString ValueText;
+};
+
+// 行为的事件触发后进入的状态
+USTRUCT()
+struct FActionDispatcherNativeTransition
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	FName EventName;
+
+	UPROPERTY()
+	int32 TargetState = INDEX_NONE;
+};
+
+USTRUCT()
+struct FActionDispatcherNativeState
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	EActionDispatcherNativeStateType Type = EActionDispatcherNativeStateType::ExecuteAction;
+
+	// 生成该状态的节点，存档中的跳转按节点与TogetherPinIndex保存，重新生成状态表后仍可找到
+	UPROPERTY()
+	FGuid NodeGuid;
+
+	UPROPERTY()
+	TSubclassOf<UXD_DispatchableActionBase> ActionClass;
+
+	UPROPERTY()
+	TArray<FActionDispatcherNativeParam> Params;
+
+	UPROPERTY()
+	TArray<FActionDispatcherNativeTransition> Transitions;
+
+	UPROPERTY()
+	FGameplayTag FinishTag;
+
+	UPROPERTY()
+	int32 TogetherNodeIndex = INDEX_NONE;
+
+	// 非共同事件的状态为0
+	UPROPERTY()
+	int32 TogetherPinIndex = 0;
+
+	UPROPERTY()
+	int32 TogetherCount = 0;
+
+	UPROPERTY()
+	int32 RequiredCount = 0;
+
+	// 共同事件触发后进入的状态
+	UPROPERTY()
+	int32 TogetherState = INDEX_NONE;
+
+	// 共同事件未触发时该输入进入的状态
+	UPROPERTY()
+	int32 WaitState = INDEX_NONE;
+};
+
 /**
- * 
+ * 编译时烘焙调度图的元数据，运行时不再需要访问蓝图资源
  */
 
 UCLASS(MinimalAPI)
@@ -15,4 +130,41 @@ class UActionDispatcherGeneratedClass : public UBlueprintGeneratedClass
 {
 	GENERATED_BODY()
 public:
+	// 0为旧版本资源，未烘焙元数据
+	UPROPERTY()
+	int32 CompiledDataVersion;
+
+	enum ECompiledDataVersion
+	{
+		InitVersion = 1,
+		NativeStateVersion = 2,
+		NativeStateNodeGuidVersion = 3,
+		LatestVersion = NativeStateNodeGuidVersion
+	};
+	bool HasCompiledData() const { return CompiledDataVersion != 0; }
+
+	UPROPERTY()
+	TArray<FName> FinishTags;
+
+	UPROPERTY()
+	TArray<FActionDispatcherNodeData> NodeDatas;
+
+	UPROPERTY()
+	int32 NodeNums[3];
+
+	// 可能为调度实体的软引用属性
+	UPROPERTY()
+	TArray<FName> EntityPropertyNames;
+
+	// 由原生解释器执行的调度图部分，为空时全部由蓝图虚拟机执行
+	UPROPERTY()
+	TArray<FActionDispatcherNativeState> NativeStates;
+
+	// 包含父类的节点数量
+	int32 GetNodeNum(EActionDispatcherNodeType NodeType) const { return NodeNums[(uint8)NodeType]; }
+	// 父类的节点数据储存在父类上，沿父类查找
+	XD_CHARACTERACTIONDISPATCHER_API const FActionDispatcherNodeData* FindNodeData(const FGuid& NodeGuid, EActionDispatcherNodeType NodeType) const;
+
+	// Class及其父类中最近的已烘焙数据的生成类
+	XD_CHARACTERACTIONDISPATCHER_API static const UActionDispatcherGeneratedClass* FindParentCompiledClass(const UClass* Class);
 };
@@ -0,0 +1,119 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <Components/ActorComponent.h>
+#include <GameplayTagContainer.h>
+#include "XD_DA_StateTagComponent.generated.h"
+
+// 编译后的Tag查询，FGameplayTagQuery展开为前序排列的指令，求值时一次遍历
+USTRUCT(BlueprintType)
+struct XD_CHARACTERACTIONDISPATCHER_API FXD_DA_StateTagQuery
+{
+	GENERATED_BODY()
+public:
+	static FXD_DA_StateTagQuery Compile(const FGameplayTagQuery& Query);
+
+	bool IsEmpty() const { return Program.Num() == 0; }
+	// 与FGameplayTagQuery::Matches一致，空查询不匹配
+	bool Matches(const TBitArray<>& StateBits) const;
+	// HasTag参数为Tags中的序号
+	template<typename THasTag>
+	bool Evaluate(const THasTag& HasTag) const
+	{
+		if (IsEmpty())
+		{
+			return false;
+		}
+		int32 Cursor = 0;
+		return EvaluateExpr(Cursor, HasTag);
+	}
+
+	UPROPERTY()
+	TArray<FGameplayTag> Tags;
+
+	// [表达式类型, 子项数量, 子项...]，Tag表达式的子项为Tags中的序号
+	UPROPERTY()
+	TArray<int32> Program;
+private:
+	// Tag在状态位中的序号，首次求值时解析
+	mutable TArray<int32> TagBitIndices;
+
+	template<typename THasTag>
+	bool EvaluateExpr(int32& Cursor, const THasTag& HasTag) const
+	{
+		const EGameplayTagQueryExprType::Type ExprType = (EGameplayTagQueryExprType::Type)Program[Cursor++];
+		const int32 ChildNum = Program[Cursor++];
+
+		int32 MatchNum = 0;
+		for (int32 Idx = 0; Idx < ChildNum; ++Idx)
+		{
+			switch (ExprType)
+			{
+			case EGameplayTagQueryExprType::AnyTagsMatch:
+			case EGameplayTagQueryExprType::AllTagsMatch:
+			case EGameplayTagQueryExprType::NoTagsMatch:
+				MatchNum += HasTag(Program[Cursor++]) ? 1 : 0;
+				break;
+			default:
+				MatchNum += EvaluateExpr(Cursor, HasTag) ? 1 : 0;
+			}
+		}
+
+		switch (ExprType)
+		{
+		case EGameplayTagQueryExprType::AnyTagsMatch:
+		case EGameplayTagQueryExprType::AnyExprMatch:
+			return MatchNum > 0;
+		case EGameplayTagQueryExprType::AllTagsMatch:
+		case EGameplayTagQueryExprType::AllExprMatch:
+			return MatchNum == ChildNum;
+		case EGameplayTagQueryExprType::NoTagsMatch:
+		case EGameplayTagQueryExprType::NoExprMatch:
+			return MatchNum == 0;
+		default:
+			return false;
+		}
+	}
+};
+
+/**
+ * 实体的调度器状态Tag，添加Tag时同时记录父Tag，检查Tag与查询只需读取位
+ * 未添加该组件的实体仍通过IXD_DispatchableEntityInterface查询
+ */
+UCLASS(ClassGroup = (XD_ActionDispatcher), meta = (BlueprintSpawnableComponent, DisplayName = "调度器状态Tag"))
+class XD_CHARACTERACTIONDISPATCHER_API UXD_DA_StateTagComponent : public UActorComponent
+{
+	GENERATED_BODY()
+public:
+	UXD_DA_StateTagComponent();
+
+	void Serialize(FArchive& Ar) override;
+#if WITH_EDITOR
+	void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "行为", SaveGame, meta = (DisplayName = "状态Tag"))
+	FGameplayTagContainer StateTags;
+
+	UFUNCTION(BlueprintPure, Category = "行为")
+	bool HasStateTag(const FGameplayTag& Tag) const;
+
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	void AddStateTag(const FGameplayTag& Tag);
+
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	void RemoveStateTag(const FGameplayTag& Tag);
+
+	UFUNCTION(BlueprintPure, Category = "行为")
+	bool MatchesStateTagQuery(const FXD_DA_StateTagQuery& Query) const;
+
+	// Tag在状态位中的序号，运行期间分配，不保存
+	static int32 GetTagBitIndex(const FGameplayTag& Tag);
+private:
+	const TBitArray<>& GetStateBits() const;
+
+	mutable TBitArray<> StateBits;
+	mutable uint8 bStateBitsDirty : 1;
+};
@@ -12,6 +12,9 @@
 
 class UXD_DispatchableActionBase;
 class UXD_ActionDispatcherManager;
+class UXD_ActionDispatcherBase;
+enum class EActionDispatcherNodeType : uint8;
+class UActionDispatcherGeneratedClass;
 
 /**
  * 
@@ -21,17 +24,90 @@ struct FTogetherFlowControl
 {
 	GENERATED_BODY()
 public:
+	FTogetherFlowControl()
+		:bFired(false)
+	{}
+
+	enum { MaxTogetherCount = 32 };
+
+	// 按位记录已到达的输入
 	UPROPERTY(SaveGame)
-	TArray<bool> CheckList;
+	uint32 ArrivedMask = 0;
 
+	// 大于0时为超时剩余时间
 	UPROPERTY(SaveGame)
-	FOnDispatchableActionFinishedEvent TogetherEvent;
+	float RemainingTime = 0.f;
+
+	// 本轮已触发，等待剩余输入到达后重置
+	UPROPERTY(SaveGame)
+	uint8 bFired : 1;
+
+	UPROPERTY(SaveGame)
+	FDispatchableActionEventDelegate TimeoutEvent;
+
+	void Reset() { *this = FTogetherFlowControl(); }
+};
+
+// 游戏线程中收集的调度器启动条件，供工作线程预检查
+struct FActionDispatcherStartSnapshot
+{
+	const UXD_ActionDispatcherBase* Dispatcher = nullptr;
+	// 与软引用属性一一对应，未解析的为空
+	TArrayView<UObject* const> SoftReferences;
+	// 与软引用属性一一对应，非实体或实体没有主调度器的为空
+	TArrayView<const UXD_ActionDispatcherBase* const> MainDispatchers;
+	int32 SoftReferenceStart = 0;
+	uint8 bLeaderValid : 1;
+	uint8 bBeLeading : 1;
+	// 为真时跳过预检查，直接在游戏线程中检查
+	uint8 bGameThreadOnly : 1;
 };
 
 DECLARE_DELEGATE_OneParam(FWhenDispatchFinishedNative, const FName& /*Tag*/);
 DECLARE_DELEGATE(FOnDispatcherAbortedNative);
 DECLARE_DELEGATE_OneParam(FOnDispatchDeactiveNative, bool /*IsFinsihedCompleted*/);
 
+// 调度器中不常用的状态，使用时才创建，减少等待中调度器的内存占用
+UCLASS(Within = "XD_ActionDispatcherBase")
+class XD_CHARACTERACTIONDISPATCHER_API UXD_ActionDispatcherExtraState : public UObject
+{
+	GENERATED_BODY()
+public:
+	// 以共同事件节点序号为下标
+	UPROPERTY(SaveGame)
+	TArray<FTogetherFlowControl> ActivedTogetherControl;
+
+	// 以子调度器节点序号为下标
+	UPROPERTY(SaveGame)
+	TArray<UXD_ActionDispatcherBase*> SubActionDispatcherSlots;
+
+	FOnDispatcherAborted OnDispatcherAborted;
+	FOnDispatcherAbortedNative OnDispatcherAbortedNative;
+
+	void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+};
+
+// 同一调度器类的实例共享的不可变数据，只在CDO上创建
+// 实例中只保存运行时状态，大量同类调度器时减少内存与启动开销
+struct FActionDispatcherClassData
+{
+	TArray<FSoftObjectProperty*> SoftObjectPropertys;
+	// 与SoftObjectPropertys一一对应，标记可能为调度实体的属性
+	TBitArray<> EntityPropertyFlags;
+
+	// 原生状态表所在的类与解析好的属性，与状态表中的数组一一对应
+	struct FNativeStateCache
+	{
+		TArray<FProperty*> ParamPropertys;
+		TArray<FProperty*> SourcePropertys;
+		TArray<FStructProperty*> EventPropertys;
+	};
+	const UActionDispatcherGeneratedClass* NativeStateClass = nullptr;
+	TArray<FNativeStateCache> NativeStateCaches;
+	// 节点的第一个状态序号，共同事件的各输入状态依次排列
+	TMap<FGuid, int32> NativeNodeStates;
+};
+
 UCLASS(abstract, BlueprintType, Blueprintable)
 class XD_CHARACTERACTIONDISPATCHER_API UXD_ActionDispatcherBase : public UObject, public FTickableGameObject
 {
@@ -44,6 +120,18 @@ public:
 	UFUNCTION(BlueprintNativeEvent, Category = "行为", meta = (DisplayName = "CanStartDispatcher"))
 	bool ReceiveCanStartDispatcher() const;
 
+	// 可在工作线程中执行的启动条件预检查，只允许读取快照与不会改变的数据
+	// 默认检查领导者、软引用与实体上的主调度器，重载时先调用父类
+	// 返回假的调度器本帧不再在游戏线程中检查
+	virtual bool CanStartDispatcher_AnyThread(const FActionDispatcherStartSnapshot& Snapshot) const;
+
+	// 在游戏线程中收集预检查所需的数据
+	void MakeStartSnapshot(FActionDispatcherStartSnapshot& OutSnapshot, TArray<UObject*>& OutSoftReferences, TArray<const UXD_ActionDispatcherBase*>& OutMainDispatchers) const;
+
+	// 为真时不做工作线程预检查，e.g. 蓝图中的启动条件依赖快照外的数据且开销较大
+	UPROPERTY(EditDefaultsOnly, Category = "行为", AdvancedDisplay)
+	uint8 bGameThreadOnlyCanStart : 1;
+
 	bool IsDispatcherValid() const;
 	// 用于确保调度器里调度的所有对象有效性
 	UFUNCTION(BlueprintNativeEvent, Category = "行为", meta = (DisplayName = "IsDispatcherValid"))
@@ -64,15 +152,45 @@ public:
 
 	bool IsDispatcherStarted() const { return CurrentActions.Num() > 0; }
 
+	// ActionIndex为编译器分配的行为节点序号，保存在执行该节点的调度器中
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
-	void InvokeActiveAction(UXD_DispatchableActionBase* Action, bool SaveAction, FGuid ActionGuid);
+	void InvokeActiveAction(UXD_DispatchableActionBase* Action, bool SaveAction, int32 ActionIndex);
 
-	virtual bool ActionIsBothCompatible(UXD_DispatchableActionBase* LHS, UXD_DispatchableActionBase* RHS) const { return false; }
+	// 执行编译器生成的原生状态，由蓝图虚拟机进入或由行为事件直接跳转
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
+	void EnterNativeState(int32 StateIndex);
+
+	// 按生成状态的节点查找状态序号，存档中的跳转读档后通过它重新定位，找不到返回INDEX_NONE
+	int32 FindNativeState(const FGuid& NodeGuid, int32 PinIndex) const;
+	void GetNativeStateNode(int32 StateIndex, FGuid& OutNodeGuid, int32& OutPinIndex) const;
+
+	// 兼容性改由行为的占用通道决定，子类的重载不再生效
+	UE_DEPRECATED(4.25, "Use UXD_DispatchableActionBase::IsCompatibleWith and OccupiedChannels instead.")
+	bool ActionIsBothCompatible(UXD_DispatchableActionBase* LHS, UXD_DispatchableActionBase* RHS) const;
 
 	// 启用MainDispatcher会导致正在运行的MainDispatcher中断
 	UPROPERTY(EditDefaultsOnly, Category = "行为", meta = (DisplayName = "为主调度器"))
 	uint8 bIsMainDispatcher : 1;
 
+	// 多个调度器争夺同一实体时优先级高的调度器优先执行
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "行为", meta = (DisplayName = "优先级"))
+	int32 Priority;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "行为", meta = (DisplayName = "抢占策略"))
+	EActionDispatcherPreemptPolicy PreemptPolicy;
+
+	// 是否可中断正在使用实体的调度器
+	bool CanPreempt(const UXD_ActionDispatcherBase* Other) const;
+
+	// 激活时租用调度实体，租约期间无法抢占该调度器的调度器不能使用这些实体
+	// 被中断后仍保留租约，避免实体被别的调度器占用导致反复中断与恢复
+	UPROPERTY(EditDefaultsOnly, Category = "行为", meta = (DisplayName = "租用实体"))
+	uint8 bLeaseEntities : 1;
+
+	// 为0时租约持续到调度器结束
+	UPROPERTY(EditDefaultsOnly, Category = "行为", meta = (DisplayName = "租约时长", EditCondition = "bLeaseEntities", ClampMin = "0"))
+	float LeaseDuration;
+
 	// 调度器的节点允许中允许直接激活别的调度器，所以要记录被哪个调度器领导
 	// 被领导的调度器的意思为：由调度行为激活的调度器，激活反激活由那个行为控制
 	UPROPERTY()
@@ -82,9 +200,6 @@ public:
 	bool IsTickable() const override;
 	TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT(UXD_ActionDispatcherBase, STATGROUP_Tickables); }
 public:
-	FOnDispatcherAborted OnDispatcherAborted;
-	FOnDispatcherAbortedNative OnDispatcherAbortedNative;
-
 	void AbortDispatch(UXD_DispatchableActionBase* DeactiveRequestAction = nullptr);
 	void AbortDispatch(const FOnDispatcherAborted& Event, UXD_DispatchableActionBase* DeactiveRequestAction = nullptr);
 	void AbortDispatch(const FOnDispatcherAbortedNative& Event, UXD_DispatchableActionBase* DeactiveRequestAction = nullptr);
@@ -103,9 +218,37 @@ protected:
 
 	bool CanReactiveDispatcher() const;
 protected:
-	TArray<FSoftObjectProperty*> SoftObjectPropertys;
+	TUniquePtr<FActionDispatcherClassData> ClassData;
+	const FActionDispatcherClassData& GetClassData() const;
 	const TArray<FSoftObjectProperty*>& GetSoftObjectPropertys() const;
+	const TBitArray<>& GetEntityPropertyFlags() const;
+	// 各类型节点的数量，用于一次分配运行时状态所需的空间，未编译的类为0
+	int32 GetNodeNum(EActionDispatcherNodeType NodeType) const;
 	void PostCDOContruct() override;
+public:
+	// 软引用的类型为Actor或实现了调度实体接口时才可能为调度实体
+	static bool IsEntitySoftObjectProperty(const FSoftObjectProperty* SoftObjectProperty);
+
+	//软引用解析缓存
+	//缓存软引用解析的结果，只有在可能出现新的引用对象时才重新解析，引用对象销毁时通过弱指针失效得知
+private:
+	mutable TArray<TWeakObjectPtr<UObject>> ResolvedSoftReferences;
+	// 与SoftObjectPropertys一一对应，置位表示已解析到对象
+	mutable TBitArray<> ResolvedSoftReferenceFlags;
+	mutable uint32 ResolvedGeneration = 0;
+
+	static uint32 SoftReferenceGeneration;
+
+	void UpdateSoftReferenceCache() const;
+protected:
+	UObject* GetResolvedSoftReference(int32 PropertyIndex) const;
+public:
+	// 可能出现新的软引用对象时调用，e.g. Actor生成、关卡加载
+	static void NotifySoftReferenceTargetsChanged();
+	// 修改软引用属性后调用
+	void InvalidateSoftReferenceCache() { ResolvedGeneration = 0; }
+
+	void GetSoftReferencePaths(TArray<FSoftObjectPath>& OutPaths) const;
 
 public:
 	// 调度器的主导者，为玩家或者主导关卡内的Actor
@@ -124,10 +267,16 @@ protected:
 	friend class UXD_DispatchableActionBase;
 	bool InvokeReactiveDispatch();
 	void ReactiveDispatcher();
+	void ActiveActionImpl(UXD_DispatchableActionBase* Action);
 
 	void ActiveDispatcher();
 private:
 	bool IsAllSoftReferenceValid() const;
+
+	// 在管理器激活列表或等待队列中的序号，由管理器维护
+	int32 ManagerIndex = INDEX_NONE;
+	// 软引用的实体所在关卡的包名，由管理器维护
+	TArray<FName, TInlineAllocator<1>> ReferencedLevels;
 	//结束调度器
 public:
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
@@ -146,18 +295,17 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
 	void BindWhenDispatchFinished(const FWhenDispatchFinished& DispatchFinishedEvent) { WhenDispatchFinished = DispatchFinishedEvent; }
 
-#if WITH_EDITORONLY_DATA
 	TArray<FName> GetAllFinishTags() const;
-#endif
 public:
 	UPROPERTY(SaveGame)
 	TArray<UXD_DispatchableActionBase*> CurrentActions;
 
+	// 以行为节点序号为下标
 	UPROPERTY(SaveGame)
-	TMap<FGuid, UXD_DispatchableActionBase*> SavedActions;
+	TArray<UXD_DispatchableActionBase*> SavedActionSlots;
 
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true, DeterminesOutputType = ActionType))
-	UXD_DispatchableActionBase* FindAction(FGuid ActionGuid, TSubclassOf<UXD_DispatchableActionBase> ActionType) const;
+	UXD_DispatchableActionBase* FindAction(int32 ActionIndex, TSubclassOf<UXD_DispatchableActionBase> ActionType) const;
 
 	void Reset();
 
@@ -169,13 +317,25 @@ public:
 	UXD_ActionDispatcherManager* GetManager() const;
 
 	UWorld* GetWorld() const override;
-	
+	void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	//不常用的状态
+private:
+	UPROPERTY(SaveGame)
+	UXD_ActionDispatcherExtraState* ExtraState;
+
+	UXD_ActionDispatcherExtraState& GetOrCreateExtraState();
+public:
+	const UXD_ActionDispatcherExtraState* GetExtraState() const { return ExtraState; }
+
 	//共同行为调度器
 public:
+	// RequiredCount为0时需全部输入到达，Timeout大于0时首个输入到达后开始计时，超时后执行TimeoutEvent
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
-	bool EnterTogetherFlowControl(FGuid NodeGuid, int32 Index, int32 TogetherCount);
-
-	TMap<FGuid, FTogetherFlowControl> ActivedTogetherControl;
+	bool EnterTogetherFlowControl(int32 NodeIndex, int32 Index, int32 TogetherCount, int32 RequiredCount, float Timeout, const FDispatchableActionEventDelegate& TimeoutEvent);
+private:
+	void TickTogetherFlowControl(float DeltaTime);
+public:
 
 	//子流程，允许逻辑分层
 	//若没有需要储存的状态更推荐使用公共宏代替
@@ -187,14 +347,22 @@ public:
 	UXD_ActionDispatcherBase* GetMainActionDispatcher();
 
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
-	void ActiveSubActionDispatcher(UXD_ActionDispatcherBase* SubActionDispatcher, FGuid NodeGuid);
+	void ActiveSubActionDispatcher(UXD_ActionDispatcherBase* SubActionDispatcher, int32 NodeIndex);
 
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
-	bool TryActiveSubActionDispatcher(FGuid NodeGuid);
+	bool TryActiveSubActionDispatcher(int32 NodeIndex);
+
+	//旧版本存档兼容
+	//旧版本以节点Guid为键集中储存在主调度器中，恢复调度器时转换为各调度器中的序号储存
+private:
+	UPROPERTY(SaveGame)
+	TMap<FGuid, UXD_DispatchableActionBase*> SavedActions;
 
 	UPROPERTY(SaveGame)
 	TMap<FGuid, UXD_ActionDispatcherBase*> ActivedSubActionDispatchers;
 
+	void RemapLegacySaveData();
+
 protected:
 	virtual void WhenActived() { ReceiveWhenActived(); }
 	UFUNCTION(BlueprintImplementableEvent, Category = "交互", meta = (DisplayName = "WhenActived"))
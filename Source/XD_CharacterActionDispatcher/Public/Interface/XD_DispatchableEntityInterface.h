@@ -6,9 +6,11 @@
 #include "UObject/Interface.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include <GameplayTagContainer.h>
+#include "Components/XD_DA_StateTagComponent.h"
 #include "XD_DispatchableEntityInterface.generated.h"
 
 class UXD_DispatchableActionBase;
+class UXD_DA_MoveTo;
 
 USTRUCT(BlueprintType, BlueprintInternalUseOnly, meta = (HasNativeMake = "XD_DispatchableActionListUtils.MakeDispatchableActionList", HasNativeBreak = "XD_DispatchableActionListUtils.BreakDispatchableActionList"))
 struct XD_CHARACTERACTIONDISPATCHER_API FXD_DispatchableActionList
@@ -64,6 +66,14 @@ public:
 	static bool HasStateTag(UObject* Obj, FGameplayTag Tag);
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
 	static void AddStateTag(UObject* Obj, FGameplayTag Tag);
+	UFUNCTION(BlueprintPure, meta = (BlueprintInternalUseOnly = true))
+	static bool MatchStateTagQuery(UObject* Obj, const FXD_DA_StateTagQuery& Query);
+
+	// 对多个实体执行同一查询，返回匹配的数量，OutResults与Entities一一对应
+	UFUNCTION(BlueprintCallable, Category = "行为")
+	static int32 MatchStateTagQueryBatch(const TArray<AActor*>& Entities, const FXD_DA_StateTagQuery& Query, TArray<bool>& OutResults);
+private:
+	static UXD_DA_StateTagComponent* FindStateTagComponent(UObject* Obj);
 };
 
 // This class does not need to be modified.
@@ -123,4 +133,16 @@ public:
 	void AD_AddStateTag(const FGameplayTag& Tag);
 	virtual void AD_AddStateTag_Implementation(const FGameplayTag& Tag) {}
 	static void AD_AddStateTag(UObject* Obj, const FGameplayTag& Tag) { IXD_DispatchableEntityInterface::Execute_AD_AddStateTag(Obj, Tag); }
+
+	// 没有AIController的实体（e.g. 由群体管理器统一驱动的轻量代理）在此处理移动请求，返回false表示无法移动
+	// 移动结束时调用MoveAction的FinishMoveRequest
+	UFUNCTION(BlueprintNativeEvent, Category = "行为")
+	bool AD_RequestMoveTo(UXD_DA_MoveTo* MoveAction, const FVector& Location, AActor* Goal);
+	virtual bool AD_RequestMoveTo_Implementation(UXD_DA_MoveTo* MoveAction, const FVector& Location, AActor* Goal) { return false; }
+	static bool AD_RequestMoveTo(UObject* Obj, UXD_DA_MoveTo* MoveAction, const FVector& Location, AActor* Goal) { return IXD_DispatchableEntityInterface::Execute_AD_RequestMoveTo(Obj, MoveAction, Location, Goal); }
+
+	UFUNCTION(BlueprintNativeEvent, Category = "行为")
+	void AD_StopMove(UXD_DA_MoveTo* MoveAction);
+	virtual void AD_StopMove_Implementation(UXD_DA_MoveTo* MoveAction) {}
+	static void AD_StopMove(UObject* Obj, UXD_DA_MoveTo* MoveAction) { IXD_DispatchableEntityInterface::Execute_AD_StopMove(Obj, MoveAction); }
 };
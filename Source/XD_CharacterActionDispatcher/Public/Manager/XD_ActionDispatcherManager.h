@@ -6,11 +6,66 @@
 #include <Components/ActorComponent.h>
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "XD_SaveGameInterface.h"
+#include "Manager/XD_ActionTimerWheel.h"
 #include "XD_ActionDispatcherManager.generated.h"
 
 class UXD_ActionDispatcherBase;
 class ULevel;
 
+// 软引用路径对应的实体与引用了该路径的调度器
+struct FDispatcherEntityReference
+{
+	TWeakObjectPtr<UObject> Entity;
+	TObjectKey<UObject> EntityKey;
+	// 未经注销流程被回收的调度器在此失效，不持有引用
+	TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>> Dispatchers;
+};
+
+// 调度器对实体的租约
+struct FDispatcherEntityLease
+{
+	// 租约到期或释放后为空
+	TWeakObjectPtr<UXD_ActionDispatcherBase> Holder;
+	// 按等待的先后顺序排列
+	TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>> Waiters;
+	// 时间轮中的到期定时器，无效时租约持续到调度器结束
+	FActionTimerHandle ExpireTimerHandle;
+};
+
+// 存档中的实体租约，读档后重建
+USTRUCT()
+struct FDispatcherEntityLeaseRecord
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	TSoftObjectPtr<UObject> Entity;
+
+	// 租约已失效时为空
+	UPROPERTY(SaveGame)
+	UXD_ActionDispatcherBase* Holder = nullptr;
+
+	// 小于等于0时租约持续到调度器结束
+	UPROPERTY(SaveGame)
+	float RemainingTime = 0.f;
+
+	UPROPERTY(SaveGame)
+	TArray<UXD_ActionDispatcherBase*> Waiters;
+};
+
+// 随关卡卸载序列化的调度器
+USTRUCT()
+struct FActionDispatcherLevelRecord
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(SaveGame)
+	FName LevelName;
+
+	// 调度器及其子对象的SaveGame属性
+	UPROPERTY(SaveGame)
+	TArray<uint8> Data;
+};
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class XD_CHARACTERACTIONDISPATCHER_API UXD_ActionDispatcherManager : public UActorComponent, public IXD_SaveGameInterface
@@ -34,12 +89,18 @@ public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 public:
+	// 无序，调度器的ManagerIndex为其在数组中的序号，移除时与末尾交换
 	UPROPERTY(SaveGame)
 	TArray<UXD_ActionDispatcherBase*> ActivedDispatchers;
 
+	// 按优先级排列，移除时留空以保持其余调度器的序号，空位过多或存档前压缩
 	UPROPERTY(SaveGame)
 	TArray<UXD_ActionDispatcherBase*> PendingDispatchers;
 
+	bool IsActivedDispatcher(const UXD_ActionDispatcherBase* Dispatcher) const;
+	bool IsPendingDispatcher(const UXD_ActionDispatcherBase* Dispatcher) const;
+	int32 GetPendingDispatcherNum() const { return PendingDispatchers.Num() - PendingHoleNum; }
+
 public:
 	static UXD_ActionDispatcherManager* Get(const UObject* WorldContextObject);
 	
@@ -49,6 +110,11 @@ private:
 #endif
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = true))
 	void InvokeStartDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+public:
+	// 批量启动调度器，e.g. 关卡加载时带入的大量环境调度器
+	// Leaders为空或与Dispatchers一一对应，当帧超出启动时间上限的调度器在之后的帧中启动
+	UFUNCTION(BlueprintCallable, Category = "行为调度器")
+	void StartDispatchers(const TArray<UXD_ActionDispatcherBase*>& Dispatchers, const TArray<TSoftObjectPtr<AActor>>& Leaders);
 protected:
 	friend class UXD_ActionDispatcherBase;
 
@@ -56,17 +122,124 @@ protected:
 	void WhenDispatcherReactived(UXD_ActionDispatcherBase* Dispatcher);
 	void WhenDispatcherDeactived(UXD_ActionDispatcherBase* Dispatcher);
 	void WhenDispatcherFinished(UXD_ActionDispatcherBase* Dispatcher);
+	void WhenDispatcherRejected(UXD_ActionDispatcherBase* Dispatcher);
+
+	// 按优先级从高到低插入等待队列，相同优先级按加入顺序排列
+	void AddPendingDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+	// SortedDispatchers需按优先级从高到低排列，与等待队列合并
+	void AddPendingDispatchers(const TArray<UXD_ActionDispatcherBase*>& SortedDispatchers);
+	void RemovePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+	void AddActivedDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+	void RemoveActivedDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+	void CompactPendingDispatchers();
+	// 读档后移除空项、按优先级重排等待队列并重建调度器的ManagerIndex
+	void RebuildDispatcherIndices();
 private:
 	uint8 bEnableAutoActivePendingAction : 1;
 	int32 ActivePendingActionIdx;
+	int32 PendingHoleNum;
+
+#if WITH_EDITOR
+	// 编辑器模块中的压力测试命令
+	friend struct FActionDispatcherManagerBenchmark;
+#endif
 
 	void InvokeActivePendingActions();
 	UFUNCTION()
 	void WhenLevelLoadCompleted(ULevel* Level);
+	void WhenPreLevelUnload(ULevel* Level);
 	UFUNCTION()
 	void WhenPostLevelUnload();
 
+	//关卡分组
+	//按软引用的实体所在的关卡分组调度器，关卡加载卸载时只处理该关卡的调度器
+	//Key为关卡的包名，值为激活或等待中引用了该关卡的调度器
+	TMap<FName, TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>> LevelDispatchers;
+	TSet<FName> UnloadedLevels;
+	// OnPreLevelUnload与关卡卸载完成之间的关卡
+	TArray<FName> UnloadingLevels;
+
+	static FName GetLevelPackageName(const ULevel* Level);
+	// 等待的实体所在关卡未加载时不需要检查
+	bool IsWaitingUnloadedLevel(const UXD_ActionDispatcherBase* Dispatcher) const;
+
+	// 关卡卸载后内存中只保留序列化的数据，跨关卡的调度器保持全局
+	UPROPERTY(SaveGame)
+	TArray<FActionDispatcherLevelRecord> UnloadedLevelRecords;
+
+	bool CanUnloadWithLevel(const UXD_ActionDispatcherBase* Dispatcher) const;
+	void UnloadLevelDispatchers(const FName& LevelName);
+	void RestoreLevelDispatchers(const FName& LevelName);
+
+	FDelegateHandle ActorSpawnedHandle;
+	void WhenActorSpawned(AActor* Actor);
+
 public:
 	//尝试强制激活Pending状态的调度器
 	void TryActivePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+
+	//实体索引
+	//管理器中的调度器共享软引用的解析结果，并可反查引用了某实体的调度器
+private:
+	TMap<FSoftObjectPath, FDispatcherEntityReference> EntityReferences;
+	TMap<TObjectKey<UObject>, FSoftObjectPath> EntityToPath;
+
+	void RegisterDispatcherReferences(UXD_ActionDispatcherBase* Dispatcher, TSet<FSoftObjectPath>* OutPaths = nullptr);
+	void UnregisterDispatcherReferences(UXD_ActionDispatcherBase* Dispatcher);
+	void RebuildEntityReferences();
+	void SetReferencedEntity(FDispatcherEntityReference& Reference, const FSoftObjectPath& Path, UObject* Entity);
+	// 复制出索引中仍有效的调度器，遍历时调度器可能结束导致索引改变
+	static TArray<UXD_ActionDispatcherBase*> GetLiveDispatchers(const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Dispatchers);
+	static void RemoveIndexedDispatcher(TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Dispatchers, const UXD_ActionDispatcherBase* Dispatcher);
+public:
+	UObject* ResolveSoftReference(const FSoftObjectPath& Path);
+
+	UFUNCTION(BlueprintCallable, Category = "行为调度器")
+	TArray<UXD_ActionDispatcherBase*> GetDispatchersReferencing(const UObject* Entity) const;
+
+	//尝试激活引用了该实体的Pending状态的调度器，实体状态改变时调用
+	UFUNCTION(BlueprintCallable, Category = "行为调度器")
+	void WakeDispatchersReferencing(const UObject* Entity);
+
+	//中断引用了该实体的正在执行的调度器
+	UFUNCTION(BlueprintCallable, Category = "行为调度器")
+	void AbortDispatchersReferencing(const UObject* Entity);
+
+	//实体租约
+private:
+	TMap<TObjectKey<UObject>, FDispatcherEntityLease> EntityLeases;
+
+	UPROPERTY(SaveGame)
+	TArray<FDispatcherEntityLeaseRecord> EntityLeaseRecords;
+
+	static bool IsLeaseActive(const FDispatcherEntityLease& Lease) { return Lease.Holder.IsValid(); }
+	// 租约失效后最先等待且仍在等待的调度器
+	static const UXD_ActionDispatcherBase* GetFirstLeaseWaiter(const FDispatcherEntityLease& Lease);
+	void WakeLeaseWaiters(const TArray<TWeakObjectPtr<UXD_ActionDispatcherBase>>& Waiters);
+	void TryWakePendingDispatcher(UXD_ActionDispatcherBase* Dispatcher);
+	void SetLeaseExpireTimer(const UObject* Entity, FDispatcherEntityLease& Lease, float Duration);
+	void WhenLeaseExpired(TObjectKey<UObject> Entity);
+	void SaveEntityLeases();
+	void RestoreEntityLeases();
+public:
+	// Duration为0时租约持续到调度器结束
+	void ReserveEntity(UXD_ActionDispatcherBase* Dispatcher, UObject* Entity, float Duration);
+	void ReleaseEntity(UXD_ActionDispatcherBase* Dispatcher, UObject* Entity);
+	void ReleaseAllEntities(UXD_ActionDispatcherBase* Dispatcher);
+
+	// 实体被无法抢占的调度器租用，或租约失效后有更早等待的调度器时返回真，不修改租约
+	bool IsEntityLeasedByOther(const UXD_ActionDispatcherBase* Dispatcher, const UObject* Entity) const;
+	// 启动或恢复失败时调用，将调度器加入被占用实体的等待队列
+	void EnqueueLeaseWaiter(UXD_ActionDispatcherBase* Dispatcher);
+
+	UFUNCTION(BlueprintCallable, Category = "行为调度器")
+	UXD_ActionDispatcherBase* GetEntityLeaseHolder(const UObject* Entity) const;
+
+	//行为定时器
+	//行为的超时与等待以及实体租约的到期由时间轮驱动，不使用TimerManager也不需要行为Tick
+private:
+	friend class UXD_DispatchableActionBase;
+	FActionTimerWheel ActionTimerWheel;
+public:
+	int32 GetActionTimerNum() const { return ActionTimerWheel.Num(); }
 };
@@ -0,0 +1,90 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <UObject/ObjectKey.h>
+
+class UXD_DispatchableActionBase;
+
+enum class EDispatchableActionTimerType : uint8
+{
+	// 行为的超时时间
+	Timeout,
+	// 行为自身设置的定时器
+	Action,
+	// 行为执行超过预期时长
+	Watchdog,
+
+	Num
+};
+constexpr int32 ActionTimerTypeNum = (int32)EDispatchableActionTimerType::Num;
+
+struct FActionTimerHandle
+{
+	int32 Index = INDEX_NONE;
+	uint32 Serial = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; }
+};
+
+/**
+ * 分层时间轮，按固定精度推进，添加与取消为O(1)
+ * 每层64个槽，低层转完一圈时下放高层的一个槽，等待中的定时器不产生每帧开销
+ */
+class XD_CHARACTERACTIONDISPATCHER_API FActionTimerWheel
+{
+public:
+	FActionTimerWheel();
+
+	void SetResolution(float InResolution);
+	float GetResolution() const { return Resolution; }
+
+	FActionTimerHandle Schedule(UXD_DispatchableActionBase* Action, EDispatchableActionTimerType Type, float Delay);
+	// 实体租约的到期时间，与行为定时器使用同一时钟
+	FActionTimerHandle ScheduleLease(const UObject* Entity, float Delay);
+	void Cancel(FActionTimerHandle& Handle);
+	bool IsActive(const FActionTimerHandle& Handle) const;
+	// 定时器不存在时返回-1
+	float GetRemainingTime(const FActionTimerHandle& Handle) const;
+	int32 Num() const { return Timers.Num() - FreeTimers.Num(); }
+
+	// 推进时间，到期的定时器移除后再回调，回调中可以添加或取消定时器
+	void Advance(float DeltaTime, TFunctionRef<void(UXD_DispatchableActionBase*, EDispatchableActionTimerType)> OnFired, TFunctionRef<void(TObjectKey<UObject>)> OnLeaseExpired);
+private:
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotNum = 1 << SlotBits;
+	static constexpr uint64 SlotMask = SlotNum - 1;
+	static constexpr int32 LevelNum = 4;
+	static constexpr uint64 MaxDelayTicks = (uint64(1) << (SlotBits * LevelNum)) - 1;
+
+	struct FTimer
+	{
+		TWeakObjectPtr<UXD_DispatchableActionBase> Action;
+		// 租约定时器的实体，实体销毁后仍需回调以清理租约
+		TObjectKey<UObject> LeaseEntity;
+		uint64 ExpireTick = 0;
+		int32 Slot = INDEX_NONE;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+		uint32 Serial = 0;
+		EDispatchableActionTimerType Type = EDispatchableActionTimerType::Action;
+		bool bLease = false;
+	};
+	TArray<FTimer> Timers;
+	TArray<int32> FreeTimers;
+	// 每个槽的链表头
+	int32 SlotHeads[SlotNum * LevelNum];
+
+	uint64 CurrentTick;
+	float AccumulatedTime;
+	float Resolution;
+
+	FActionTimerHandle AddTimer(float Delay, FTimer*& OutTimer);
+	const FTimer* FindTimer(const FActionTimerHandle& Handle) const;
+	void LinkTimer(int32 TimerIndex);
+	void UnlinkTimer(int32 TimerIndex);
+	void FreeTimer(int32 TimerIndex);
+	void CascadeSlot(int32 Slot);
+};
@@ -27,4 +27,33 @@ public:
 	UPROPERTY(EditAnywhere, Category = "设置", Config)
 	uint8 bShowPluginClass : 1;
 #endif
+
+	// 每帧预检查的等待中调度器数量
+	UPROPERTY(EditAnywhere, Category = "运行时", Config, meta = (ClampMin = "1"))
+	int32 PendingEvaluateBatchNum;
+
+	// 预检查数量达到该值时在工作线程中并行执行
+	UPROPERTY(EditAnywhere, Category = "运行时", Config, meta = (ClampMin = "1"))
+	int32 ParallelEvaluateMinNum;
+
+	// 每帧在游戏线程中确认并激活等待中调度器的时间上限（秒）
+	UPROPERTY(EditAnywhere, Category = "运行时", Config, meta = (ClampMin = "0"))
+	float ActivePendingTimeLimit;
+
+	// 批量启动调度器时当帧启动的时间上限（秒），超时的调度器进入等待队列在之后的帧中启动
+	UPROPERTY(EditAnywhere, Category = "运行时", Config, meta = (ClampMin = "0"))
+	float BulkStartTimeLimit;
+
+	// 关卡卸载时将只引用该关卡实体的等待中调度器序列化，关卡加载时还原
+	// 还原的是新对象，开启前需确认没有在别处直接持有这些调度器的引用
+	UPROPERTY(EditAnywhere, Category = "运行时", Config)
+	uint8 bUnloadDispatchersWithLevel : 1;
+
+	// 行为定时器时间轮的精度（秒），超时与等待的误差不超过该值
+	UPROPERTY(EditAnywhere, Category = "运行时", Config, meta = (ClampMin = "0.001"))
+	float ActionTimerResolution;
+
+	// 检查执行超过预期时长的行为，预期时长与处理方式在行为类中设置
+	UPROPERTY(EditAnywhere, Category = "运行时", Config)
+	uint8 bEnableActionWatchdog : 1;
 };
@@ -0,0 +1,18 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <Stats/Stats.h>
+
+/**
+ * 
+ */
+DECLARE_STATS_GROUP(TEXT("ActionDispatcher"), STATGROUP_ActionDispatcher, STATCAT_Advanced);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatcher Abort"), STAT_ActionDispatcher_Abort, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dispatcher Reactive"), STAT_ActionDispatcher_Reactive, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Entity Lease Blocked"), STAT_ActionDispatcher_LeaseBlocked, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Watchdog Stuck Action"), STAT_ActionDispatcher_WatchdogStuck, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Watchdog Recovered Action"), STAT_ActionDispatcher_WatchdogRecovered, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Watchdog Aborted Dispatcher"), STAT_ActionDispatcher_WatchdogAborted, STATGROUP_ActionDispatcher, XD_CHARACTERACTIONDISPATCHER_API);
@@ -11,6 +11,8 @@
  */
 DECLARE_DYNAMIC_DELEGATE(FDispatchableActionEventDelegate);
 
+class UXD_ActionDispatcherBase;
+
 USTRUCT()
 struct XD_CHARACTERACTIONDISPATCHER_API FDispatchableActionEventBase
 {
@@ -18,6 +20,21 @@ struct XD_CHARACTERACTIONDISPATCHER_API FDispatchableActionEventBase
 public:
 	UPROPERTY(SaveGame)
 	FDispatchableActionEventDelegate Event;
+
+	// 原生状态表中的跳转，绑定后不经过蓝图虚拟机
+	UPROPERTY(SaveGame)
+	TWeakObjectPtr<UXD_ActionDispatcherBase> NativeDispatcher;
+	// 状态序号随状态表重新生成而变化，存档只保存目标节点，读档后重新查找
+	UPROPERTY(SaveGame)
+	FGuid NativeNodeGuid;
+	UPROPERTY(SaveGame)
+	int32 NativePinIndex = 0;
+	UPROPERTY()
+	int32 NativeState = INDEX_NONE;
+
+	void BindNativeState(UXD_ActionDispatcherBase* Dispatcher, int32 StateIndex);
+protected:
+	void ExecuteEvent() const;
 };
 
 USTRUCT(BlueprintType)
@@ -26,7 +43,7 @@ struct XD_CHARACTERACTIONDISPATCHER_API FOnDispatchableActionFinishedEvent : pub
 	GENERATED_BODY()
 private:
 	friend class UXD_DispatchableActionBase;
-	void ExecuteIfBound() const { Event.ExecuteIfBound(); }
+	void ExecuteIfBound() const { ExecuteEvent(); }
 };
 
 USTRUCT(BlueprintType)
@@ -34,7 +51,7 @@ struct XD_CHARACTERACTIONDISPATCHER_API FDispatchableActionNormalEvent : public
 {
 	GENERATED_BODY()
 public:
-	void ExecuteIfBound() const { Event.ExecuteIfBound(); }
+	void ExecuteIfBound() const { ExecuteEvent(); }
 };
 
 DECLARE_DYNAMIC_DELEGATE(FOnDispatcherAborted);
@@ -87,3 +104,40 @@ enum class EActionDispatcherState : uint8
 	Active = 1,
 	Aborting = 2
 };
+
+UENUM()
+enum class EActionDispatcherPreemptPolicy : uint8
+{
+	// 可抢占优先级不高于自身的调度器，包括同优先级的调度器
+	PreemptLower UMETA(DisplayName = "抢占低优先级"),
+	// 只抢占优先级低于自身的调度器，实体被同优先级或更高优先级的调度器占用时等待
+	QueueBehind UMETA(DisplayName = "排队等待"),
+	// 不抢占别的调度器，执行中实体被占用时放弃执行
+	Reject UMETA(DisplayName = "放弃执行")
+};
+
+// 行为在实体上占用的通道，占用通道不重叠的行为可同时执行
+UENUM(meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EDispatchableActionChannel : uint8
+{
+	None = 0 UMETA(Hidden),
+	Locomotion = 1 << 0 UMETA(DisplayName = "移动"),
+	Dialogue = 1 << 1 UMETA(DisplayName = "对话"),
+	Animation = 1 << 2 UMETA(DisplayName = "动画"),
+	Interaction = 1 << 3 UMETA(DisplayName = "交互"),
+	Camera = 1 << 4 UMETA(DisplayName = "镜头"),
+	// 所有声明的通道，新增通道时需同步
+	All = Locomotion | Dialogue | Animation | Interaction | Camera UMETA(Hidden)
+};
+ENUM_CLASS_FLAGS(EDispatchableActionChannel);
+
+UENUM()
+enum class EDispatchableActionWatchdogPolicy : uint8
+{
+	// 只记录日志与统计
+	ReportOnly UMETA(DisplayName = "只报告"),
+	// 调用行为的恢复处理，e.g. 执行无法到达事件，无法恢复时只报告
+	Recover UMETA(DisplayName = "恢复"),
+	// 中断行为所在的调度器
+	Abort UMETA(DisplayName = "中断调度器")
+};
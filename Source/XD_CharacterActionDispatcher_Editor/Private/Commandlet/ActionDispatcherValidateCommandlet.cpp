@@ -0,0 +1,211 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Commandlet/ActionDispatcherValidateCommandlet.h"
+#include <AssetRegistryModule.h>
+#include <Async/ParallelFor.h>
+#include <Kismet2/CompilerResultsLog.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+#include <Serialization/JsonWriter.h>
+#include <Policies/PrettyJsonPrintPolicy.h>
+#include <K2Node_Event.h>
+
+#include "Blueprint/ActionDispatcherBlueprint.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
+#include "Compiler/ActionDispatcherBP_Compiler.h"
+#include "Compiler/LinkToFinishNodeChecker.h"
+#include "XD_CharacterActionDispatcher_EditorUtility.h"
+
+namespace ActionDispatcherValidate
+{
+	struct FMessage
+	{
+		EMessageSeverity::Type Severity;
+		FString Text;
+	};
+
+	struct FResult
+	{
+		FString Path;
+		TArray<FMessage> Messages;
+		int32 ErrorNum = 0;
+		int32 WarningNum = 0;
+	};
+
+	// 只读检查，可在工作线程执行，不修改蓝图
+	void Validate(UActionDispatcherBlueprint* Blueprint, FResult& Result)
+	{
+		// 不注册为编译事件目标，也不标注节点，避免多线程写共享状态
+		FCompilerResultsLog MessageLog(false);
+		MessageLog.bSilentMode = true;
+		MessageLog.bAnnotateMentionedNodes = false;
+
+		FActionDispatcherBP_Compiler::ValidateVariables(Blueprint, MessageLog, false);
+		if (UK2Node_Event* WhenDispatchStartNode = FActionDispatcherBP_Compiler::FindWhenDispatchStartNode(Blueprint))
+		{
+			FLinkToFinishNodeChecker::CheckForceConnectFinishNode(WhenDispatchStartNode, MessageLog);
+		}
+		else
+		{
+			MessageLog.Error(TEXT("需要实现[执行调度]WhenDispatchStart事件"));
+		}
+		const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Blueprint->GeneratedClass);
+		if (GeneratedClass && GeneratedClass->HasCompiledData())
+		{
+			FActionDispatcherBP_Compiler::ValidateNodeIndices(GeneratedClass, MessageLog);
+		}
+
+		for (const TSharedRef<FTokenizedMessage>& Message : MessageLog.Messages)
+		{
+			Result.Messages.Add(FMessage{ Message->GetSeverity(), Message->ToText().ToString() });
+		}
+		Result.ErrorNum = MessageLog.NumErrors;
+		Result.WarningNum = MessageLog.NumWarnings;
+	}
+
+	const TCHAR* GetSeverityName(EMessageSeverity::Type Severity)
+	{
+		switch (Severity)
+		{
+		case EMessageSeverity::CriticalError:
+		case EMessageSeverity::Error:
+			return TEXT("Error");
+		case EMessageSeverity::PerformanceWarning:
+		case EMessageSeverity::Warning:
+			return TEXT("Warning");
+		default:
+			return TEXT("Info");
+		}
+	}
+
+	FString WriteReport(const TArray<FResult>& Results, double Seconds)
+	{
+		int32 ErrorBlueprintNum = 0;
+		for (const FResult& Result : Results)
+		{
+			ErrorBlueprintNum += Result.ErrorNum > 0 ? 1 : 0;
+		}
+
+		FString JsonText;
+		TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&JsonText);
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("BlueprintNum"), Results.Num());
+		Writer->WriteValue(TEXT("ErrorBlueprintNum"), ErrorBlueprintNum);
+		Writer->WriteValue(TEXT("Seconds"), Seconds);
+		Writer->WriteArrayStart(TEXT("Blueprints"));
+		for (const FResult& Result : Results)
+		{
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("Path"), Result.Path);
+			Writer->WriteValue(TEXT("Errors"), Result.ErrorNum);
+			Writer->WriteValue(TEXT("Warnings"), Result.WarningNum);
+			Writer->WriteArrayStart(TEXT("Messages"));
+			for (const FMessage& Message : Result.Messages)
+			{
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("Severity"), GetSeverityName(Message.Severity));
+				Writer->WriteValue(TEXT("Text"), Message.Text);
+				Writer->WriteObjectEnd();
+			}
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+		Writer->Close();
+		return JsonText;
+	}
+}
+
+UActionDispatcherValidateCommandlet::UActionDispatcherValidateCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UActionDispatcherValidateCommandlet::Main(const FString& Params)
+{
+	using namespace ActionDispatcherValidate;
+
+	FString SearchPath = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Path="), SearchPath);
+	FString ReportPath = FPaths::ProjectSavedDir() / TEXT("ActionDispatcherValidation.json");
+	FParse::Value(*Params, TEXT("Report="), ReportPath);
+	int32 BatchSize = 256;
+	FParse::Value(*Params, TEXT("BatchSize="), BatchSize);
+	BatchSize = FMath::Max(BatchSize, 1);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassNames.Add(UActionDispatcherBlueprint::StaticClass()->GetFName());
+	Filter.bRecursiveClasses = true;
+	Filter.PackagePaths.Add(*SearchPath);
+	Filter.bRecursivePaths = true;
+	TArray<FAssetData> AssetDatas;
+	AssetRegistry.GetAssets(Filter, AssetDatas);
+	AssetDatas.Sort([](const FAssetData& LHS, const FAssetData& RHS) { return LHS.ObjectPath.LexicalLess(RHS.ObjectPath); });
+	ActionDispatcher_Editor_Display_Log("在%s下找到%d个行为调度器蓝图", *SearchPath, AssetDatas.Num());
+
+	TArray<FResult> Results;
+	Results.SetNum(AssetDatas.Num());
+	TArray<UActionDispatcherBlueprint*> Blueprints;
+	for (int32 BatchStart = 0; BatchStart < AssetDatas.Num(); BatchStart += BatchSize)
+	{
+		const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, AssetDatas.Num());
+
+		// 资源只能在主线程加载
+		Blueprints.Reset();
+		for (int32 Idx = BatchStart; Idx < BatchEnd; ++Idx)
+		{
+			Results[Idx].Path = AssetDatas[Idx].ObjectPath.ToString();
+			Blueprints.Add(Cast<UActionDispatcherBlueprint>(AssetDatas[Idx].GetAsset()));
+		}
+
+		ParallelFor(Blueprints.Num(), [&](int32 Idx)
+			{
+				FResult& Result = Results[BatchStart + Idx];
+				if (UActionDispatcherBlueprint* Blueprint = Blueprints[Idx])
+				{
+					Validate(Blueprint, Result);
+				}
+				else
+				{
+					Result.Messages.Add(FMessage{ EMessageSeverity::Error, TEXT("蓝图加载失败") });
+					Result.ErrorNum = 1;
+				}
+			});
+
+		ActionDispatcher_Editor_Display_Log("已检查%d/%d", BatchEnd, AssetDatas.Num());
+		Blueprints.Reset();
+		CollectGarbage(RF_NoFlags);
+	}
+
+	int32 ErrorBlueprintNum = 0;
+	for (const FResult& Result : Results)
+	{
+		if (Result.ErrorNum > 0)
+		{
+			ErrorBlueprintNum += 1;
+			for (const FMessage& Message : Result.Messages)
+			{
+				ActionDispatcher_Editor_Warning_LOG("%s: %s", *Result.Path, *Message.Text);
+			}
+		}
+	}
+
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+	if (!FFileHelper::SaveStringToFile(WriteReport(Results, Seconds), *ReportPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		ActionDispatcher_Editor_Error_Log("报告写入失败：%s", *ReportPath);
+		return 1;
+	}
+
+	ActionDispatcher_Editor_Display_Log("检查%d个蓝图，%d个存在错误，耗时%.2f秒，报告：%s", Results.Num(), ErrorBlueprintNum, Seconds, *ReportPath);
+	return ErrorBlueprintNum > 0 ? 1 : 0;
+}
@@ -8,6 +8,7 @@
 
 #include "Compiler/LinkToFinishNodeChecker.h"
 #include "CustomBpNode/BpNode_FinishDispatch.h"
+#include "Compiler/ActionDispatcherNativeTableBuilder.h"
 
 FActionDispatcherBP_Compiler::FActionDispatcherBP_Compiler(UActionDispatcherBlueprint* SourceSketch, FCompilerResultsLog& InMessageLog, const FKismetCompilerOptions& InCompilerOptions)
 	: FKismetCompilerContext(SourceSketch, InMessageLog, InCompilerOptions)
@@ -24,59 +25,43 @@ void FActionDispatcherBP_Compiler::PreCompile()
 {
 	Super::PreCompile();
 
-	if (CompileOptions.CompileType != EKismetCompileType::SkeletonOnly)
+	// 父类节点的序号在前，子类节点从父类的数量开始编号，避免共用运行时状态的下标
+	int32 ParentNodeNums[3] = {};
+	if (const UActionDispatcherGeneratedClass* ParentGeneratedClass = UActionDispatcherGeneratedClass::FindParentCompiledClass(Blueprint->ParentClass))
 	{
-		for (FBPVariableDescription& BPVariableDescription : Blueprint->NewVariables)
-		{
-			EPropertyFlags Flags = (EPropertyFlags)BPVariableDescription.PropertyFlags;
-			if ((Flags & CPF_Edit) != CPF_Edit)
-			{
-				continue;
-			}
+		FMemory::Memcpy(ParentNodeNums, ParentGeneratedClass->NodeNums, sizeof(ParentNodeNums));
+	}
+	FMemory::Memcpy(CompiledNodeNums, ParentNodeNums, sizeof(CompiledNodeNums));
 
-			bool isMarkSaveGame = (Flags & CPF_SaveGame) == CPF_SaveGame;
-			if ((Flags & CPF_DisableEditOnInstance) != CPF_DisableEditOnInstance)
+	// 存档中的节点状态按序号保存，已有节点沿用上次的序号，新节点追加在后，删除的节点留空
+	for (TMap<FGuid, int32>& NodeIndices : PreviousNodeIndices)
+	{
+		NodeIndices.Reset();
+	}
+	const UActionDispatcherGeneratedClass* PreviousGeneratedClass = Cast<UActionDispatcherGeneratedClass>(Blueprint->GeneratedClass);
+	if (PreviousGeneratedClass && PreviousGeneratedClass->HasCompiledData())
+	{
+		for (const FActionDispatcherNodeData& NodeData : PreviousGeneratedClass->NodeDatas)
+		{
+			const uint8 TypeIdx = (uint8)NodeData.NodeType;
+			// 父类新增节点后与子类的序号重叠，只能重新分配
+			if (NodeData.TypeIndex >= ParentNodeNums[TypeIdx])
 			{
-				if (!(isMarkSaveGame && BPVariableDescription.HasMetaData(FBlueprintMetadata::MD_ExposeOnSpawn)))
-				{
-					MessageLog.Error(*FString::Printf(TEXT("[%s] 暴露变量需添加标记[保存游戏]SaveGame与[在生成时显示]ExposeOnSpawn，已自动修复"), *BPVariableDescription.VarName.ToString()));
-					BPVariableDescription.PropertyFlags |= CPF_SaveGame;
-					BPVariableDescription.SetMetaData(FBlueprintMetadata::MD_ExposeOnSpawn, TEXT("true"));
-				}
+				PreviousNodeIndices[TypeIdx].Add(NodeData.NodeGuid, NodeData.TypeIndex);
+				CompiledNodeNums[TypeIdx] = FMath::Max(CompiledNodeNums[TypeIdx], NodeData.TypeIndex + 1);
 			}
 			else
 			{
-				bool isBlueprintReadOnly = (Flags & CPF_BlueprintReadOnly) == CPF_BlueprintReadOnly;
-				if (!(isBlueprintReadOnly || BPVariableDescription.HasMetaData(FBlueprintMetadata::MD_Private)))
-				{
-					if (!isMarkSaveGame)
-					{
-						MessageLog.Error(*FString::Printf(TEXT("[%s] 非暴露变量需添加标记SaveGame或标记为[只读蓝图]BlueprintReadOnly或者[私有]Private，已自动设置SaveGame"), *BPVariableDescription.VarName.ToString()));
-						BPVariableDescription.PropertyFlags |= CPF_SaveGame;
-					}
-				}
+				MessageLog.Warning(*FString::Printf(TEXT("父类新增了节点，节点%s的序号需重新分配，旧存档中该节点的状态将无法恢复"), *NodeData.NodeGuid.ToString()));
 			}
 		}
-		
-		UK2Node_Event* WhenDispatchStartNode = Cast<UK2Node_Event>(ActionDispatcherBlueprint->WhenDispatchStartNode);
-		if (WhenDispatchStartNode == nullptr)
-		{
-			for (UEdGraph* Ubergraph : Blueprint->UbergraphPages)
-			{
-				for (UEdGraphNode* Node : Ubergraph->Nodes)
-				{
-					if (UK2Node_Event* EventNode = Cast<UK2Node_Event>(Node))
-					{
-						if (EventNode->GetFunctionName() == GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, WhenDispatchStart))
-						{
-							WhenDispatchStartNode = EventNode;
-							goto FindNode;
-						}
-					}
-				}
-			}
-		}
-	FindNode:
+	}
+
+	if (CompileOptions.CompileType != EKismetCompileType::SkeletonOnly)
+	{
+		ValidateVariables(Blueprint, MessageLog, true);
+
+		UK2Node_Event* WhenDispatchStartNode = FindWhenDispatchStartNode(ActionDispatcherBlueprint);
 		if (WhenDispatchStartNode)
 		{
 			FLinkToFinishNodeChecker Checker = FLinkToFinishNodeChecker::CheckForceConnectFinishNode(WhenDispatchStartNode, MessageLog);
@@ -92,6 +77,30 @@ void FActionDispatcherBP_Compiler::PreCompile()
 					}
 				}
 			}
+
+			if (ActionDispatcherBlueprint->bCompileNativeStateTable)
+			{
+				// 父类已有状态表时蓝图虚拟机中的状态序号以父类为准
+				const UActionDispatcherGeneratedClass* ParentGeneratedClass = nullptr;
+				for (UClass* Class = Blueprint->ParentClass; Class && ParentGeneratedClass == nullptr; Class = Class->GetSuperClass())
+				{
+					const UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Class);
+					if (GeneratedClass && GeneratedClass->NativeStates.Num() > 0)
+					{
+						ParentGeneratedClass = GeneratedClass;
+					}
+				}
+
+				if (ParentGeneratedClass)
+				{
+					MessageLog.Warning(*FString::Printf(TEXT("父类[%s]已生成原生状态表，该蓝图不再生成状态表"), *ParentGeneratedClass->GetName()));
+				}
+				else
+				{
+					FActionDispatcherNativeTableBuilder NativeTableBuilder(*this);
+					NativeTableBuilder.Build(Checker.VisitedNodes, NativeStates, NativeNodeStates);
+				}
+			}
 		}
 		else
 		{
@@ -119,4 +128,155 @@ void FActionDispatcherBP_Compiler::SpawnNewClass(const FString& NewClassName)
 void FActionDispatcherBP_Compiler::FinishCompilingClass(UClass* Class)
 {
 	Super::FinishCompilingClass(Class);
+
+	// 将运行时需要的图信息烘焙至生成类
+	if (UActionDispatcherGeneratedClass* GeneratedClass = Cast<UActionDispatcherGeneratedClass>(Class))
+	{
+		GeneratedClass->CompiledDataVersion = UActionDispatcherGeneratedClass::LatestVersion;
+		GeneratedClass->FinishTags = ActionDispatcherBlueprint->FinishTags;
+		GeneratedClass->NodeDatas = CompiledNodeDatas;
+		FMemory::Memcpy(GeneratedClass->NodeNums, CompiledNodeNums, sizeof(CompiledNodeNums));
+		GeneratedClass->NativeStates = NativeStates;
+
+		GeneratedClass->EntityPropertyNames.Empty();
+		for (TFieldIterator<FSoftObjectProperty> It(GeneratedClass, EFieldIteratorFlags::IncludeSuper); It; ++It)
+		{
+			if (UXD_ActionDispatcherBase::IsEntitySoftObjectProperty(*It))
+			{
+				GeneratedClass->EntityPropertyNames.Add(It->GetFName());
+			}
+		}
+	}
+}
+
+FActionDispatcherBP_Compiler* FActionDispatcherBP_Compiler::Get(FKismetCompilerContext& CompilerContext)
+{
+	if (CompilerContext.Blueprint && CompilerContext.Blueprint->IsA<UActionDispatcherBlueprint>())
+	{
+		return static_cast<FActionDispatcherBP_Compiler*>(&CompilerContext);
+	}
+	return nullptr;
+}
+
+int32 FActionDispatcherBP_Compiler::RegisterDispatcherNode(const UEdGraphNode* Node, EActionDispatcherNodeType NodeType, int32 TogetherCount)
+{
+	if (int32* P_NodeDataIndex = RegisteredNodes.Find(Node))
+	{
+		const FActionDispatcherNodeData& NodeData = CompiledNodeDatas[*P_NodeDataIndex];
+		check(NodeData.NodeType == NodeType);
+		return NodeData.TypeIndex;
+	}
+
+	FActionDispatcherNodeData& NodeData = CompiledNodeDatas.AddDefaulted_GetRef();
+	NodeData.NodeGuid = Node->NodeGuid;
+	NodeData.NodeType = NodeType;
+	if (const int32* P_PreviousIndex = PreviousNodeIndices[(uint8)NodeType].Find(Node->NodeGuid))
+	{
+		NodeData.TypeIndex = *P_PreviousIndex;
+	}
+	else
+	{
+		NodeData.TypeIndex = CompiledNodeNums[(uint8)NodeType]++;
+	}
+	NodeData.TogetherCount = TogetherCount;
+	RegisteredNodes.Add(Node, CompiledNodeDatas.Num() - 1);
+	return NodeData.TypeIndex;
+}
+
+int32 FActionDispatcherBP_Compiler::FindNativeState(const UEdGraphNode* Node) const
+{
+	const int32* P_StateIndex = NativeNodeStates.Find(Node->NodeGuid);
+	return P_StateIndex ? *P_StateIndex : INDEX_NONE;
 }
+
+void FActionDispatcherBP_Compiler::ValidateVariables(UBlueprint* Blueprint, FCompilerResultsLog& MessageLog, bool bAutoFix)
+{
+	for (FBPVariableDescription& BPVariableDescription : Blueprint->NewVariables)
+	{
+		EPropertyFlags Flags = (EPropertyFlags)BPVariableDescription.PropertyFlags;
+		if ((Flags & CPF_Edit) != CPF_Edit)
+		{
+			continue;
+		}
+
+		bool isMarkSaveGame = (Flags & CPF_SaveGame) == CPF_SaveGame;
+		if ((Flags & CPF_DisableEditOnInstance) != CPF_DisableEditOnInstance)
+		{
+			if (!(isMarkSaveGame && BPVariableDescription.HasMetaData(FBlueprintMetadata::MD_ExposeOnSpawn)))
+			{
+				MessageLog.Error(*FString::Printf(TEXT("[%s] 暴露变量需添加标记[保存游戏]SaveGame与[在生成时显示]ExposeOnSpawn%s"), *BPVariableDescription.VarName.ToString(), bAutoFix ? TEXT("，已自动修复") : TEXT("")));
+				if (bAutoFix)
+				{
+					BPVariableDescription.PropertyFlags |= CPF_SaveGame;
+					BPVariableDescription.SetMetaData(FBlueprintMetadata::MD_ExposeOnSpawn, TEXT("true"));
+				}
+			}
+		}
+		else
+		{
+			bool isBlueprintReadOnly = (Flags & CPF_BlueprintReadOnly) == CPF_BlueprintReadOnly;
+			if (!(isBlueprintReadOnly || BPVariableDescription.HasMetaData(FBlueprintMetadata::MD_Private)))
+			{
+				if (!isMarkSaveGame)
+				{
+					MessageLog.Error(*FString::Printf(TEXT("[%s] 非暴露变量需添加标记SaveGame或标记为[只读蓝图]BlueprintReadOnly或者[私有]Private%s"), *BPVariableDescription.VarName.ToString(), bAutoFix ? TEXT("，已自动设置SaveGame") : TEXT("")));
+					if (bAutoFix)
+					{
+						BPVariableDescription.PropertyFlags |= CPF_SaveGame;
+					}
+				}
+			}
+		}
+	}
+}
+
+void FActionDispatcherBP_Compiler::ValidateNodeIndices(const UActionDispatcherGeneratedClass* GeneratedClass, FCompilerResultsLog& MessageLog)
+{
+	const UActionDispatcherGeneratedClass* ParentGeneratedClass = UActionDispatcherGeneratedClass::FindParentCompiledClass(GeneratedClass->GetSuperClass());
+	TSet<int32> UsedIndices[3];
+	for (const UClass* Class = GeneratedClass; Class; Class = Class->GetSuperClass())
+	{
+		const UActionDispatcherGeneratedClass* OwnerClass = Cast<UActionDispatcherGeneratedClass>(Class);
+		if (OwnerClass == nullptr)
+		{
+			continue;
+		}
+		for (const FActionDispatcherNodeData& NodeData : OwnerClass->NodeDatas)
+		{
+			const uint8 TypeIdx = (uint8)NodeData.NodeType;
+			bool bIsAlreadyInSet;
+			UsedIndices[TypeIdx].Add(NodeData.TypeIndex, &bIsAlreadyInSet);
+			if (bIsAlreadyInSet || NodeData.TypeIndex < 0 || NodeData.TypeIndex >= GeneratedClass->NodeNums[TypeIdx])
+			{
+				MessageLog.Error(*FString::Printf(TEXT("[%s]中节点%s的序号%d冲突或越界，需重新编译"), *OwnerClass->GetName(), *NodeData.NodeGuid.ToString(), NodeData.TypeIndex));
+			}
+			else if (OwnerClass == GeneratedClass && ParentGeneratedClass && NodeData.TypeIndex < ParentGeneratedClass->NodeNums[TypeIdx])
+			{
+				MessageLog.Error(*FString::Printf(TEXT("节点%s的序号%d与父类[%s]的节点重叠，需重新编译"), *NodeData.NodeGuid.ToString(), NodeData.TypeIndex, *ParentGeneratedClass->GetName()));
+			}
+		}
+	}
+}
+
+UK2Node_Event* FActionDispatcherBP_Compiler::FindWhenDispatchStartNode(UActionDispatcherBlueprint* Blueprint)
+{
+	if (UK2Node_Event* WhenDispatchStartNode = Cast<UK2Node_Event>(Blueprint->WhenDispatchStartNode))
+	{
+		return WhenDispatchStartNode;
+	}
+
+	for (UEdGraph* Ubergraph : Blueprint->UbergraphPages)
+	{
+		for (UEdGraphNode* Node : Ubergraph->Nodes)
+		{
+			if (UK2Node_Event* EventNode = Cast<UK2Node_Event>(Node))
+			{
+				if (EventNode->GetFunctionName() == GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, WhenDispatchStart))
+				{
+					return EventNode;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
\ No newline at end of file
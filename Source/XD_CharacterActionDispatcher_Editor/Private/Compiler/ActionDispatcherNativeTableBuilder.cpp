@@ -0,0 +1,348 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Compiler/ActionDispatcherNativeTableBuilder.h"
+#include <EdGraphSchema_K2.h>
+#include <K2Node_Knot.h>
+#include <K2Node_VariableGet.h>
+
+#include "Compiler/ActionDispatcherBP_Compiler.h"
+#include "Dispatcher/XD_ActionDispatcherBase.h"
+#include "CustomBpNode/BpNode_ExecuteAction.h"
+#include "CustomBpNode/BpNode_FinishDispatch.h"
+#include "CustomBpNode/BpNode_FlowControl_Together.h"
+#include "CustomBpNode/Utils/DA_CustomBpNodeUtils.h"
+
+namespace NativeTableBuilder
+{
+	// 跳过Knot节点，返回执行引脚实际连接的输入引脚
+	UEdGraphPin* FindTargetPin(UEdGraphPin* OutputPin)
+	{
+		if (OutputPin->LinkedTo.Num() != 1)
+		{
+			return nullptr;
+		}
+		UEdGraphPin* TargetPin = OutputPin->LinkedTo[0];
+		while (UK2Node_Knot* Knot = Cast<UK2Node_Knot>(TargetPin->GetOwningNode()))
+		{
+			UEdGraphPin* KnotOutputPin = Knot->GetOutputPin();
+			if (KnotOutputPin->LinkedTo.Num() != 1)
+			{
+				return nullptr;
+			}
+			TargetPin = KnotOutputPin->LinkedTo[0];
+		}
+		return TargetPin;
+	}
+
+	void CollectSourcePins(UEdGraphPin* InputPin, TArray<UEdGraphPin*>& OutSourcePins)
+	{
+		for (UEdGraphPin* LinkedPin : InputPin->LinkedTo)
+		{
+			if (UK2Node_Knot* Knot = Cast<UK2Node_Knot>(LinkedPin->GetOwningNode()))
+			{
+				CollectSourcePins(Knot->GetInputPin(), OutSourcePins);
+			}
+			else
+			{
+				OutSourcePins.Add(LinkedPin);
+			}
+		}
+	}
+
+	bool IsExecPin(const UEdGraphPin* Pin, EEdGraphPinDirection Direction)
+	{
+		return Pin->Direction == Direction && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec;
+	}
+
+	// 生成时赋值的属性，与DA_NodeUtils::GenerateAssignmentNodes的判断一致
+	FProperty* FindAssignProperty(UBpNode_ExecuteAction* Node, UEdGraphPin* Pin, UClass* ClassToSpawn)
+	{
+		if (Pin->Direction != EGPD_Input || Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec || !Node->IsSpawnVarPin(Pin))
+		{
+			return nullptr;
+		}
+		FProperty* Property = FindFProperty<FProperty>(ClassToSpawn, Pin->PinName);
+		return Property && Property->GetBoolMetaData(FBlueprintMetadata::MD_ExposeOnSpawn) ? Property : nullptr;
+	}
+
+	// 只支持直接读取调度器自身的成员变量
+	FProperty* FindSourceMemberProperty(UEdGraphPin* Pin, FProperty* Property, UClass* SelfClass)
+	{
+		UK2Node_VariableGet* VariableGet = Cast<UK2Node_VariableGet>(Pin->LinkedTo[0]->GetOwningNode());
+		if (VariableGet == nullptr || !VariableGet->VariableReference.IsSelfContext())
+		{
+			return nullptr;
+		}
+		UEdGraphPin* SelfPin = VariableGet->FindPin(UEdGraphSchema_K2::PN_Self);
+		if (SelfPin && SelfPin->LinkedTo.Num() > 0)
+		{
+			return nullptr;
+		}
+		FProperty* SourceProperty = SelfClass ? FindFProperty<FProperty>(SelfClass, VariableGet->GetVarName()) : nullptr;
+		return SourceProperty && SourceProperty->SameType(Property) ? SourceProperty : nullptr;
+	}
+
+	bool HasDefaultValue(const UEdGraphPin* Pin)
+	{
+		return !Pin->DefaultValue.IsEmpty() || !Pin->DefaultTextValue.IsEmpty() || Pin->DefaultObject;
+	}
+}
+
+FActionDispatcherNativeTableBuilder::FActionDispatcherNativeTableBuilder(FActionDispatcherBP_Compiler& Compiler)
+	:Compiler(Compiler)
+{
+
+}
+
+void FActionDispatcherNativeTableBuilder::Build(const TSet<UEdGraphNode*>& VisitedNodes, TArray<FActionDispatcherNativeState>& OutStates, TMap<FGuid, int32>& OutNodeStates)
+{
+	// 宏中的节点每次展开NodeGuid相同，只处理事件图表中的节点
+	for (UEdGraphNode* Node : VisitedNodes)
+	{
+		if (Compiler.Blueprint->UbergraphPages.Contains(Node->GetGraph()) && CanCompileNode(Node))
+		{
+			NativeNodes.Add(Node);
+		}
+	}
+
+	// 移除会跳转至蓝图虚拟机节点的节点，直到状态表闭合
+	for (bool bChanged = true; bChanged;)
+	{
+		bChanged = false;
+		for (auto It = NativeNodes.CreateIterator(); It; ++It)
+		{
+			if (!IsNodeClosed(*It))
+			{
+				It.RemoveCurrent();
+				bChanged = true;
+			}
+		}
+	}
+
+	if (NativeNodes.Num() == 0)
+	{
+		return;
+	}
+
+	// 按NodeGuid排序保证同一张图的状态序号确定，增删节点后序号会变化，运行时存档只保存节点
+	TArray<UEdGraphNode*> SortedNodes = NativeNodes.Array();
+	SortedNodes.Sort([](const UEdGraphNode& LHS, const UEdGraphNode& RHS) { return LHS.NodeGuid < RHS.NodeGuid; });
+
+	int32 StateNum = 0;
+	for (UEdGraphNode* Node : SortedNodes)
+	{
+		NodeStates.Add(Node, StateNum);
+		OutNodeStates.Add(Node->NodeGuid, StateNum);
+		const UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(Node);
+		StateNum += TogetherNode ? TogetherNode->GetTogetherEventCount() : 1;
+	}
+
+	OutStates.Reserve(StateNum);
+	for (UEdGraphNode* Node : SortedNodes)
+	{
+		if (UBpNode_ExecuteAction* ExecuteActionNode = Cast<UBpNode_ExecuteAction>(Node))
+		{
+			AddExecuteActionState(ExecuteActionNode, OutStates);
+		}
+		else if (UBpNode_FinishDispatch* FinishDispatchNode = Cast<UBpNode_FinishDispatch>(Node))
+		{
+			FActionDispatcherNativeState& State = OutStates.AddDefaulted_GetRef();
+			State.Type = EActionDispatcherNativeStateType::FinishDispatch;
+			State.NodeGuid = FinishDispatchNode->NodeGuid;
+			State.FinishTag = FinishDispatchNode->Tag;
+		}
+		else if (UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(Node))
+		{
+			const int32 TogetherCount = TogetherNode->GetTogetherEventCount();
+			const int32 NodeIndex = Compiler.RegisterDispatcherNode(TogetherNode, EActionDispatcherNodeType::TogetherFlowControl, TogetherCount);
+			const int32 TogetherState = GetTargetState(TogetherNode->GetTogetherEventPin());
+			for (int32 Idx = 0; Idx < TogetherCount; ++Idx)
+			{
+				FActionDispatcherNativeState& State = OutStates.AddDefaulted_GetRef();
+				State.Type = EActionDispatcherNativeStateType::Together;
+				State.NodeGuid = TogetherNode->NodeGuid;
+				State.TogetherNodeIndex = NodeIndex;
+				State.TogetherPinIndex = Idx;
+				State.TogetherCount = TogetherCount;
+				State.RequiredCount = TogetherNode->RequiredCount;
+				State.TogetherState = TogetherState;
+				State.WaitState = GetTargetState(TogetherNode->GetWaitPin(Idx));
+			}
+		}
+	}
+	check(OutStates.Num() == StateNum);
+
+	Compiler.MessageLog.Note(*FString::Printf(TEXT("%d个节点编译为原生状态，共%d个状态"), SortedNodes.Num(), StateNum));
+}
+
+bool FActionDispatcherNativeTableBuilder::CanCompileNode(UEdGraphNode* Node) const
+{
+	if (UBpNode_ExecuteAction* ExecuteActionNode = Cast<UBpNode_ExecuteAction>(Node))
+	{
+		return CanCompileExecuteAction(ExecuteActionNode);
+	}
+	else if (Node->IsA<UBpNode_FinishDispatch>())
+	{
+		return true;
+	}
+	else if (UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(Node))
+	{
+		// 超时需要蓝图中的超时事件
+		return TogetherNode->Timeout <= 0.f && TogetherNode->GetTogetherEventCount() <= FTogetherFlowControl::MaxTogetherCount;
+	}
+	return false;
+}
+
+bool FActionDispatcherNativeTableBuilder::CanCompileExecuteAction(UBpNode_ExecuteAction* Node) const
+{
+	UClass* ClassToSpawn = Node->GetClassToSpawn();
+	if (ClassToSpawn == nullptr || ClassToSpawn->HasAnyClassFlags(CLASS_Abstract))
+	{
+		return false;
+	}
+
+	// 使用了行为引用的节点需要保存行为
+	UEdGraphPin* ThenPin = Node->GetThenPin();
+	UEdGraphPin* ResultPin = Node->GetResultPin();
+	if ((ThenPin && ThenPin->LinkedTo.Num() > 0) || (ResultPin && ResultPin->LinkedTo.Num() > 0))
+	{
+		return false;
+	}
+
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		if (Pin->Direction != EGPD_Input || Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec)
+		{
+			continue;
+		}
+
+		FProperty* Property = NativeTableBuilder::FindAssignProperty(Node, Pin, ClassToSpawn);
+		if (Pin->LinkedTo.Num() > 0)
+		{
+			if (Property == nullptr || NativeTableBuilder::FindSourceMemberProperty(Pin, Property, Compiler.Blueprint->SkeletonGeneratedClass) == nullptr)
+			{
+				return false;
+			}
+		}
+		else if (Property && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Struct && NativeTableBuilder::HasDefaultValue(Pin))
+		{
+			// 向量等结构体引脚的默认值格式不能直接ImportText
+			if (!Pin->DefaultValue.StartsWith(TEXT("(")) && !DA_NodeUtils::IsPinDefaultValueMatchClass(Compiler, Pin, ClassToSpawn, Property))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool FActionDispatcherNativeTableBuilder::IsNodeClosed(UEdGraphNode* Node) const
+{
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		if (NativeTableBuilder::IsExecPin(Pin, EGPD_Output) && !IsNativeTargetPin(Pin))
+		{
+			return false;
+		}
+	}
+
+	// 共同事件的状态由原生状态跳转进入，不能由蓝图虚拟机进入
+	if (UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(Node))
+	{
+		TArray<UEdGraphPin*> SourcePins;
+		for (UEdGraphPin* Pin : Node->Pins)
+		{
+			if (NativeTableBuilder::IsExecPin(Pin, EGPD_Input))
+			{
+				NativeTableBuilder::CollectSourcePins(Pin, SourcePins);
+			}
+		}
+		for (UEdGraphPin* SourcePin : SourcePins)
+		{
+			if (!NativeNodes.Contains(SourcePin->GetOwningNode()))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool FActionDispatcherNativeTableBuilder::IsNativeTargetPin(UEdGraphPin* OutputPin) const
+{
+	if (OutputPin->LinkedTo.Num() == 0)
+	{
+		return true;
+	}
+
+	UEdGraphPin* TargetPin = NativeTableBuilder::FindTargetPin(OutputPin);
+	if (TargetPin == nullptr || !NativeNodes.Contains(TargetPin->GetOwningNode()))
+	{
+		return false;
+	}
+	if (UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(TargetPin->GetOwningNode()))
+	{
+		return TogetherNode->GetExecPinIndex(TargetPin) != INDEX_NONE;
+	}
+	return NativeTableBuilder::IsExecPin(TargetPin, EGPD_Input);
+}
+
+int32 FActionDispatcherNativeTableBuilder::GetTargetState(UEdGraphPin* OutputPin) const
+{
+	UEdGraphPin* TargetPin = NativeTableBuilder::FindTargetPin(OutputPin);
+	if (TargetPin == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	const UEdGraphNode* TargetNode = TargetPin->GetOwningNode();
+	const int32 StateIndex = NodeStates.FindChecked(TargetNode);
+	if (const UBpNode_FlowControl_Together* TogetherNode = Cast<UBpNode_FlowControl_Together>(TargetNode))
+	{
+		return StateIndex + TogetherNode->GetExecPinIndex(TargetPin);
+	}
+	return StateIndex;
+}
+
+void FActionDispatcherNativeTableBuilder::AddExecuteActionState(UBpNode_ExecuteAction* Node, TArray<FActionDispatcherNativeState>& OutStates) const
+{
+	UClass* ClassToSpawn = Node->GetClassToSpawn();
+
+	FActionDispatcherNativeState& State = OutStates.AddDefaulted_GetRef();
+	State.Type = EActionDispatcherNativeStateType::ExecuteAction;
+	State.NodeGuid = Node->NodeGuid;
+	State.ActionClass = ClassToSpawn;
+
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		if (NativeTableBuilder::IsExecPin(Pin, EGPD_Output))
+		{
+			if (Pin->LinkedTo.Num() > 0)
+			{
+				FActionDispatcherNativeTransition& Transition = State.Transitions.AddDefaulted_GetRef();
+				Transition.EventName = Pin->PinName;
+				Transition.TargetState = GetTargetState(Pin);
+			}
+			continue;
+		}
+
+		FProperty* Property = NativeTableBuilder::FindAssignProperty(Node, Pin, ClassToSpawn);
+		if (Property == nullptr)
+		{
+			continue;
+		}
+
+		if (Pin->LinkedTo.Num() > 0)
+		{
+			FActionDispatcherNativeParam& Param = State.Params.AddDefaulted_GetRef();
+			Param.PropertyName = Property->GetFName();
+			Param.SourceMemberName = NativeTableBuilder::FindSourceMemberProperty(Pin, Property, Compiler.Blueprint->SkeletonGeneratedClass)->GetFName();
+		}
+		else if (NativeTableBuilder::HasDefaultValue(Pin) && !DA_NodeUtils::IsPinDefaultValueMatchClass(Compiler, Pin, ClassToSpawn, Property))
+		{
+			FActionDispatcherNativeParam& Param = State.Params.AddDefaulted_GetRef();
+			Param.PropertyName = Property->GetFName();
+			Param.ValueText = Pin->GetDefaultAsString();
+		}
+	}
+}
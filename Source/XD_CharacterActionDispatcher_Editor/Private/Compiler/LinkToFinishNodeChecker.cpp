@@ -6,111 +6,197 @@
 #include <Kismet2/CompilerResultsLog.h>
 #include <K2Node_Composite.h>
 #include <K2Node_MacroInstance.h>
+#include <EdGraph/EdGraph.h>
 
 #include "CustomBpNode/Utils/DA_CustomBpNodeUtils.h"
 #include "Interface/DA_BpNodeInterface.h"
 #include "CustomBpNode/BpNode_FinishDispatch.h"
 
-bool FNodeLinkCheckerBase::CheckNextNode(UEdGraphNode* Node)
+const TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>& FNodeLinkCheckerCache::GetMacroTunnels(const UEdGraph* MacroGraph)
 {
-	if (VisitedNodes.Contains(Node))
+	if (const TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>* P_Tunnels = MacroTunnels.Find(MacroGraph))
 	{
-		return false;
+		return *P_Tunnels;
 	}
 
-	VisitedNodes.Add(Node);
+	TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>& Tunnels = MacroTunnels.Add(MacroGraph, TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>(nullptr, nullptr));
+	if (MacroGraph)
+	{
+		for (UEdGraphNode* Node : MacroGraph->Nodes)
+		{
+			if (Node && Node->GetClass() == UK2Node_Tunnel::StaticClass())
+			{
+				UK2Node_Tunnel* SubTunnelNode = (UK2Node_Tunnel*)Node;
+				if (SubTunnelNode->bCanHaveOutputs)
+				{
+					Tunnels.Key = SubTunnelNode;
+				}
+				else
+				{
+					Tunnels.Value = SubTunnelNode;
+				}
+			}
+		}
+	}
+	return Tunnels;
+}
+
+const TArray<UEdGraphPin*>& FNodeLinkCheckerCache::GetExecOutputPins(const UEdGraphNode* Node)
+{
+	if (const TArray<UEdGraphPin*>* P_ExecOutputPins = ExecOutputPins.Find(Node))
+	{
+		return *P_ExecOutputPins;
+	}
 
-	return ExecuteCheck(Node);
+	TArray<UEdGraphPin*>& Pins = ExecOutputPins.Add(Node);
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		if (Pin->Direction == EGPD_Output && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec)
+		{
+			Pins.Add(Pin);
+		}
+	}
+	return Pins;
 }
 
-void FNodeLinkCheckerBase::ConvertRetargetPin(UEdGraphPin*& Pin, bool& bShowErrorOnLinkedPin)
+void FNodeLinkCheckerBase::CheckNextNode(UEdGraphNode* Node, int32 MacroFrame)
 {
-	for (UEdGraphPin* LinkToPin : Pin->LinkedTo)
+	bool bIsAlreadyVisited;
+	VisitedNodes.Add(Node, &bIsAlreadyVisited);
+	if (!bIsAlreadyVisited)
 	{
-		if (UK2Node_Tunnel* TunnelNode = Cast<UK2Node_Tunnel>(LinkToPin->GetOwningNode()))
+		PendingNodes.Add(FPendingNode{ Node, MacroFrame });
+	}
+}
+
+bool FNodeLinkCheckerBase::RunCheck()
+{
+	// 使用队列代替递归，节点过多时不会栈溢出
+	while (PendingNodes.Num() > 0)
+	{
+		const FPendingNode PendingNode = PendingNodes.Pop(false);
+		CurrentMacroFrame = PendingNode.MacroFrame;
+		if (ExecuteCheck(PendingNode.Node))
+		{
+			PendingNodes.Reset();
+			CurrentMacroFrame = INDEX_NONE;
+			return true;
+		}
+	}
+	CurrentMacroFrame = INDEX_NONE;
+	return false;
+}
+
+int32 FNodeLinkCheckerBase::ConvertRetargetPin(UEdGraphPin*& Pin, bool& bShowErrorOnLinkedPin)
+{
+	int32 MacroFrame = CurrentMacroFrame;
+	for (bool bRetargeted = true; bRetargeted;)
+	{
+		bRetargeted = false;
+		for (UEdGraphPin* LinkToPin : Pin->LinkedTo)
 		{
+			UK2Node_Tunnel* TunnelNode = Cast<UK2Node_Tunnel>(LinkToPin->GetOwningNode());
+			if (TunnelNode == nullptr)
+			{
+				continue;
+			}
+
 			//宏的输入中转
 			if (UK2Node_MacroInstance* MacroInstanceNode = Cast<UK2Node_MacroInstance>(TunnelNode))
 			{
-				UK2Node_Tunnel* InputTunnelNode = nullptr;
-				UK2Node_Tunnel* OutputTunnelNode = nullptr;
-
-				for (UEdGraphNode* Node : MacroInstanceNode->GetMacroGraph()->Nodes)
-				{
-					if (Node && Node->GetClass() == UK2Node_Tunnel::StaticClass())
-					{
-						UK2Node_Tunnel* SubTunnelNode = (UK2Node_Tunnel*)Node;
-						if (SubTunnelNode->bCanHaveOutputs)
-						{
-							InputTunnelNode = SubTunnelNode;
-						}
-						else
-						{
-							OutputTunnelNode = SubTunnelNode;
-						}
-					}
-				}
-
-				if (OutputTunnelNode)
-				{
-					MacroNodeLinkers.FindOrAdd(OutputTunnelNode) = MacroInstanceNode;
-				}
-
-				if (InputTunnelNode)
+				if (UK2Node_Tunnel* InputTunnelNode = GetCache().GetMacroTunnels(MacroInstanceNode->GetMacroGraph()).Key)
 				{
+					MacroFrame = MacroFrames.Add(FMacroFrame{ MacroInstanceNode, MacroFrame });
 					Pin = InputTunnelNode->FindPinChecked(LinkToPin->PinName);
 					bShowErrorOnLinkedPin = false;
-					ConvertRetargetPin(Pin, bShowErrorOnLinkedPin);
-					return;
+					bRetargeted = true;
 				}
 			}
 			else
 			{
-				//宏的输出中转
-				if (UK2Node_MacroInstance** P_MacroInstanceNode = MacroNodeLinkers.Find(TunnelNode))
+				//宏的输出中转，返回进入宏时的宏实例
+				if (MacroFrame != INDEX_NONE && MacroFrames[MacroFrame].MacroInstance->GetMacroGraph() == TunnelNode->GetGraph())
 				{
-					MacroInstanceNode = *P_MacroInstanceNode;
-					Pin = MacroInstanceNode->FindPinChecked(LinkToPin->PinName);
+					Pin = MacroFrames[MacroFrame].MacroInstance->FindPinChecked(LinkToPin->PinName);
+					MacroFrame = MacroFrames[MacroFrame].ParentFrame;
 					bShowErrorOnLinkedPin = true;
-					ConvertRetargetPin(Pin, bShowErrorOnLinkedPin);
-					return;
+					bRetargeted = true;
 				}
-
 				//合并节点处理
-				if (TunnelNode->InputSinkNode)
+				else if (TunnelNode->InputSinkNode)
 				{
 					Pin = TunnelNode->InputSinkNode->FindPinChecked(LinkToPin->PinName);
 					bShowErrorOnLinkedPin = LinkToPin->Direction == EGPD_Input;
-					ConvertRetargetPin(Pin, bShowErrorOnLinkedPin);
-					return;
+					bRetargeted = true;
 				}
 			}
+
+			if (bRetargeted)
+			{
+				break;
+			}
 		}
 	}
+	return MacroFrame;
+}
+
+const TArray<UEdGraphPin*>& FNodeLinkCheckerBase::GetExecOutputPins(const UEdGraphNode* Node)
+{
+	return GetCache().GetExecOutputPins(Node);
 }
 
 FLinkToFinishNodeChecker FLinkToFinishNodeChecker::CheckForceConnectFinishNode(UEdGraphNode* Node, FCompilerResultsLog& MessageLog)
 {
 	FLinkToFinishNodeChecker Checker(MessageLog, false);
 	Checker.CheckNextNode(Node);
+	Checker.RunCheck();
+
+	// 不可连接[结束调度器]的检查共享索引与结果，检查中新加入的引脚继续处理
+	FNodeLinkCheckerCache& SharedCache = Checker.GetCache();
+	for (int32 Idx = 0; Idx < SharedCache.ForceNotConnectPins.Num(); ++Idx)
+	{
+		FLinkToFinishNodeChecker NotConnectChecker(MessageLog, true);
+		NotConnectChecker.Cache = &SharedCache;
+		NotConnectChecker.RunForceNotConnectCheck(SharedCache.ForceNotConnectPins[Idx]);
+	}
 	return Checker;
 }
 
-void FLinkToFinishNodeChecker::CheckForceNotConnectFinishNode(UEdGraphPin* Pin, FCompilerResultsLog& MessageLog)
+void FLinkToFinishNodeChecker::CheckForceNotConnectFinishNode(UEdGraphPin* Pin)
+{
+	GetCache().ForceNotConnectPins.AddUnique(Pin);
+}
+
+void FLinkToFinishNodeChecker::RunForceNotConnectCheck(UEdGraphPin* Pin)
 {
+	FNodeLinkCheckerCache& SharedCache = GetCache();
+	UEdGraphNode* StartNode = Pin->GetOwningNode();
+	StartSearchPin = Pin;
+	VisitedNodes.Add(StartNode);
+
 	for (UEdGraphPin* LinkedPin : Pin->LinkedTo)
 	{
-		if (LinkedPin->GetOwningNode()->IsA<UBpNode_FinishDispatch>())
+		UEdGraphNode* LinkedNode = LinkedPin->GetOwningNode();
+		if (LinkedNode->IsA<UBpNode_FinishDispatch>())
 		{
-			MessageLog.Error(TEXT("从@@ 出发的所有节点不可连接 @@ 节点"), Pin, LinkedPin->GetOwningNode());
+			MessageLog.Error(TEXT("从@@ 出发的所有节点不可连接 @@ 节点"), Pin, LinkedNode);
+			bCanCacheResult = false;
 		}
-		else
+		else if (!SharedCache.NoFinishNodes.Contains(LinkedNode))
 		{
-			FLinkToFinishNodeChecker Checker(MessageLog, true);
-			Checker.StartSearchPin = Pin;
-			Checker.VisitedNodes.Add(Pin->GetOwningNode());
+			CheckNextNode(LinkedNode);
+		}
+	}
+	RunCheck();
 
-			Checker.CheckNextNode(LinkedPin->GetOwningNode());
+	if (bCanCacheResult)
+	{
+		for (UEdGraphNode* Node : VisitedNodes)
+		{
+			if (Node != StartNode)
+			{
+				SharedCache.NoFinishNodes.Add(Node);
+			}
 		}
 	}
 }
@@ -123,12 +209,9 @@ bool FLinkToFinishNodeChecker::ExecuteCheck(UEdGraphNode* Node)
 	}
 	else
 	{
-		for (UEdGraphPin* Pin : Node->Pins)
+		for (UEdGraphPin* Pin : GetExecOutputPins(Node))
 		{
-			if (Pin->Direction == EGPD_Output && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec)
-			{
-				CheckPinConnectedFinishNode(Pin);
-			}
+			CheckPinConnectedFinishNode(Pin);
 		}
 	}
 	return false;
@@ -138,24 +221,39 @@ void FLinkToFinishNodeChecker::CheckPinConnectedFinishNode(UEdGraphPin* Pin)
 {
 	UEdGraphPin* RetargetPin = Pin;
 	bool bShowErrorOnLinkedPin = false;
-	ConvertRetargetPin(RetargetPin, bShowErrorOnLinkedPin);
+	const int32 MacroFrame = ConvertRetargetPin(RetargetPin, bShowErrorOnLinkedPin);
 	UEdGraphPin* ShowErrorPin = bShowErrorOnLinkedPin ? RetargetPin : Pin;
 
 	if (RetargetPin->LinkedTo.Num() > 0)
 	{
 		for (UEdGraphPin* LinkedPin : RetargetPin->LinkedTo)
 		{
-			if (bForceNotConnectFinishedNode && LinkedPin->GetOwningNode()->IsA<UBpNode_FinishDispatch>())
+			UEdGraphNode* LinkedNode = LinkedPin->GetOwningNode();
+			if (bForceNotConnectFinishedNode)
 			{
-				MessageLog.Error(TEXT("从@@ 出发的所有节点不可连接 @@ 节点，因为可能会执行[结束调度器]节点"), StartSearchPin, ShowErrorPin->GetOwningNode(), LinkedPin->GetOwningNode());
-				break;
+				if (LinkedNode->IsA<UBpNode_FinishDispatch>())
+				{
+					MessageLog.Error(TEXT("从@@ 出发的所有节点不可连接 @@ 节点，因为可能会执行[结束调度器]节点"), StartSearchPin, ShowErrorPin->GetOwningNode(), LinkedNode);
+					bCanCacheResult = false;
+					break;
+				}
+
+				// 宏内的结果与宏实例相关，回到起始节点时结果依赖起始节点，都不记录
+				if (MacroFrame != INDEX_NONE || LinkedNode == StartSearchPin->GetOwningNode())
+				{
+					bCanCacheResult = false;
+				}
+				else if (GetCache().NoFinishNodes.Contains(LinkedNode))
+				{
+					continue;
+				}
 			}
 
-			CheckNextNode(LinkedPin->GetOwningNode());
+			CheckNextNode(LinkedNode, MacroFrame);
 		}
 	}
 	else if (bForceNotConnectFinishedNode == false)
 	{
 		MessageLog.Error(TEXT("@@ 需要连接[结束调度器]节点"), ShowErrorPin);
 	}
-}
+}
\ No newline at end of file
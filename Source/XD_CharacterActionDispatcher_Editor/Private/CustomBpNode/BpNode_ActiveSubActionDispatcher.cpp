@@ -14,6 +14,7 @@
 #include <K2Node_Knot.h>
 #include <K2Node_IfThenElse.h>
 #include <K2Node_SwitchName.h>
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
 
 #define LOCTEXT_NAMESPACE "XD_CharacterActionDispatcher"
 
@@ -63,7 +64,7 @@ bool UBpNode_ActiveSubActionDispatcher::IsCompatibleWithGraph(const UEdGraph* Ta
 void UBpNode_ActiveSubActionDispatcher::AllocateDefaultPins()
 {
 	Super::AllocateDefaultPins();
-	GetClassPin()->DefaultObject = ActionDispatcherClass;
+	GetClassPin()->DefaultObject = ActionDispatcherClass.Get();
 }
 
 void UBpNode_ActiveSubActionDispatcher::ShowExtendPins(UClass* UseSpawnClass)
@@ -79,14 +80,7 @@ void UBpNode_ActiveSubActionDispatcher::PinDefaultValueChanged(UEdGraphPin* Chan
 	if (ChangedPin && (ChangedPin->PinName == TEXT("Class")))
 	{
 		ActionDispatcherClass = GetClassToSpawn();
-		if (ActionDispatcherClass)
-		{
-			FinishedTags = ActionDispatcherClass.GetDefaultObject()->GetAllFinishTags();
-		}
-		else
-		{
-			FinishedTags.Empty();
-		}
+		FinishedTags = DA_NodeUtils::GetDispatcherFinishTags(ActionDispatcherClass);
 		ReconstructNode();
 	}
 }
@@ -95,12 +89,18 @@ void UBpNode_ActiveSubActionDispatcher::ExpandNode(class FKismetCompilerContext&
 {
 	Super::ExpandNode(CompilerContext, SourceGraph);
 
-	if (ActionDispatcherClass == nullptr)
+	if (ActionDispatcherClass.LoadSynchronous() == nullptr)
 	{
 		CompilerContext.MessageLog.Error(*LOCTEXT("激活子调度器_类型为空Error", "ICE: @@类型不得为空").ToString(), this);
 		return;
 	}
 
+	const int32 NodeIndex = DA_NodeUtils::RegisterDispatcherNode(this, CompilerContext, EActionDispatcherNodeType::SubActionDispatcher);
+	if (NodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
 	UK2Node_Knot* FinishedNode = CompilerContext.SpawnIntermediateNode<UK2Node_Knot>(this, SourceGraph);
 	FinishedNode->AllocateDefaultPins();
 	CompilerContext.MovePinLinksToIntermediate(*GetThenPin(), *FinishedNode->GetOutputPin());
@@ -116,8 +116,7 @@ void UBpNode_ActiveSubActionDispatcher::ExpandNode(class FKismetCompilerContext&
 	TryActiveSubActionDispatcherNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, TryActiveSubActionDispatcher), UXD_ActionDispatcherBase::StaticClass());
 	TryActiveSubActionDispatcherNode->AllocateDefaultPins();
 	bSucceeded &= CompilerContext.MovePinLinksToIntermediate(*GetExecPin(), *TryActiveSubActionDispatcherNode->GetExecPin()).CanSafeConnect();
-	DA_NodeUtils::SetPinStructValue(TryActiveSubActionDispatcherNode->FindPinChecked(TEXT("NodeGuid")), NodeGuid);
-	GetMainActionDispatcherNode->GetReturnValuePin()->MakeLinkTo(TryActiveSubActionDispatcherNode->FindPinChecked(UEdGraphSchema_K2::PN_Self));
+	TryActiveSubActionDispatcherNode->FindPinChecked(TEXT("NodeIndex"))->DefaultValue = FString::FromInt(NodeIndex);
 
 	UK2Node_IfThenElse* BranchNode = CompilerContext.SpawnIntermediateNode<UK2Node_IfThenElse>(this, SourceGraph);
 	BranchNode->AllocateDefaultPins();
@@ -172,9 +171,8 @@ void UBpNode_ActiveSubActionDispatcher::ExpandNode(class FKismetCompilerContext&
 		UK2Node_CallFunction* ActiveSubActionDispatcherNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
 		ActiveSubActionDispatcherNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, ActiveSubActionDispatcher), UXD_ActionDispatcherBase::StaticClass());
 		ActiveSubActionDispatcherNode->AllocateDefaultPins();
-		DA_NodeUtils::SetPinStructValue(ActiveSubActionDispatcherNode->FindPinChecked(TEXT("NodeGuid")), NodeGuid);
+		ActiveSubActionDispatcherNode->FindPinChecked(TEXT("NodeIndex"))->DefaultValue = FString::FromInt(NodeIndex);
 		ActiveSubActionDispatcherNode->FindPinChecked(TEXT("SubActionDispatcher"))->MakeLinkTo(CallCreateNode->GetReturnValuePin());
-		GetMainActionDispatcherNode->GetReturnValuePin()->MakeLinkTo(ActiveSubActionDispatcherNode->FindPinChecked(UEdGraphSchema_K2::PN_Self));
 		LastThen->MakeLinkTo(ActiveSubActionDispatcherNode->GetExecPin());
 		LastThen = ActiveSubActionDispatcherNode->GetThenPin();
 
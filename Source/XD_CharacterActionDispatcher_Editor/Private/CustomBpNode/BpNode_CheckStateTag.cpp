@@ -91,7 +91,8 @@ void UBpNode_CheckStateTag::ExpandNode(class FKismetCompilerContext& CompilerCon
 			bool Check(UEdGraphNode* Node, UEdGraphNode* InTargetNode)
 			{
 				TargetNode = InTargetNode;
-				return CheckNextNode(Node);
+				CheckNextNode(Node);
+				return RunCheck();
 			}
 		private:
 			UEdGraphNode* TargetNode;
@@ -103,20 +104,14 @@ void UBpNode_CheckStateTag::ExpandNode(class FKismetCompilerContext& CompilerCon
 					return true;
 				}
 
-				for (UEdGraphPin* Pin : Node->Pins)
+				for (UEdGraphPin* Pin : GetExecOutputPins(Node))
 				{
-					if (Pin->Direction == EGPD_Output && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec)
+					UEdGraphPin* RetargetPin = Pin;
+					bool bShowErrorOnLinkedPin;
+					const int32 MacroFrame = ConvertRetargetPin(RetargetPin, bShowErrorOnLinkedPin);
+					for (UEdGraphPin* LinkToPin : RetargetPin->LinkedTo)
 					{
-						for (UEdGraphPin* LinkToPin : Pin->LinkedTo)
-						{
-							bool bShowErrorOnLinkedPin;
-							ConvertRetargetPin(LinkToPin, bShowErrorOnLinkedPin);
-							UEdGraphNode* NextNode = LinkToPin->GetOwningNode();
-							if (CheckNextNode(NextNode))
-							{
-								return true;
-							}
-						}
+						CheckNextNode(LinkToPin->GetOwningNode(), MacroFrame);
 					}
 				}
 				return false;
@@ -151,12 +146,24 @@ void UBpNode_CheckStateTag::ExpandNode(class FKismetCompilerContext& CompilerCon
 	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TagNotExistPinName), *BranchNode->GetElsePin());
 	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TagExistPinName), *BranchNode->GetThenPin());
 
-	UK2Node_CallFunction* HasStateTagNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
-	HasStateTagNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_DA_StateTagUtils, HasStateTag), UXD_DA_StateTagUtils::StaticClass());
-	HasStateTagNode->AllocateDefaultPins();
-	HasStateTagNode->FindPinChecked(TEXT("Obj"))->MakeLinkTo(TragetPin->LinkedTo[0]);
-	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TagPinName), *HasStateTagNode->FindPinChecked(TEXT("Tag")));
-	HasStateTagNode->GetReturnValuePin()->MakeLinkTo(BranchNode->GetConditionPin());
+	if (TagQuery.IsEmpty())
+	{
+		UK2Node_CallFunction* HasStateTagNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		HasStateTagNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_DA_StateTagUtils, HasStateTag), UXD_DA_StateTagUtils::StaticClass());
+		HasStateTagNode->AllocateDefaultPins();
+		HasStateTagNode->FindPinChecked(TEXT("Obj"))->MakeLinkTo(TragetPin->LinkedTo[0]);
+		CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TagPinName), *HasStateTagNode->FindPinChecked(TEXT("Tag")));
+		HasStateTagNode->GetReturnValuePin()->MakeLinkTo(BranchNode->GetConditionPin());
+	}
+	else
+	{
+		UK2Node_CallFunction* MatchQueryNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+		MatchQueryNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_DA_StateTagUtils, MatchStateTagQuery), UXD_DA_StateTagUtils::StaticClass());
+		MatchQueryNode->AllocateDefaultPins();
+		MatchQueryNode->FindPinChecked(TEXT("Obj"))->MakeLinkTo(TragetPin->LinkedTo[0]);
+		DA_NodeUtils::SetPinStructValue(MatchQueryNode->FindPinChecked(TEXT("Query")), FXD_DA_StateTagQuery::Compile(TagQuery));
+		MatchQueryNode->GetReturnValuePin()->MakeLinkTo(BranchNode->GetConditionPin());
+	}
 }
 
 void UBpNode_CheckStateTag::PostPlacedNewNode()
@@ -17,6 +17,7 @@
 #include "K2Node_VariableGet.h"
 #include <K2Node_CustomEvent.h>
 #include "CustomBpNode/Utils/DA_CustomBpNodeUtils.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
 
 struct FBpNode_CreateActionFromClassHelper
 {
@@ -29,6 +30,130 @@ FName FBpNode_CreateActionFromClassHelper::WorldContextPinName(TEXT("WorldContex
 FName FBpNode_CreateActionFromClassHelper::ClassPinName(TEXT("Class"));
 FName FBpNode_CreateActionFromClassHelper::OuterPinName(TEXT("Outer"));
 
+namespace CreateObjectPinLayout
+{
+	struct FPinInfo
+	{
+		FName PropertyName;
+		FEdGraphPinType PinType;
+		FText FriendlyName;
+		FText ToolTipText;
+		FString DefaultValue;
+		uint8 bAdvancedView : 1;
+		uint8 bHasDefaultValue : 1;
+	};
+
+	struct FLayout
+	{
+		// 构建布局时的默认对象，类重新编译后会创建新的默认对象
+		TWeakObjectPtr<const UObject> ClassDefaultObject;
+		TArray<FPinInfo> PinInfos;
+	};
+
+	TMap<TWeakObjectPtr<UClass>, FLayout> CachedLayouts;
+
+	void BuildLayout(UClass* InClass, FLayout& Layout)
+	{
+		const UEdGraphSchema_K2* K2Schema = GetDefault<UEdGraphSchema_K2>();
+		const UObject* const ClassDefaultObject = InClass->GetDefaultObject(false);
+
+		TArray<FProperty*> SortedExposePropertys;
+
+		TArray<FProperty*> CurrentClassPropertys;
+		UClass* CurrentClass = InClass;
+		for (TFieldIterator<FProperty> PropertyIt(InClass, EFieldIteratorFlags::IncludeSuper); PropertyIt; ++PropertyIt)
+		{
+			FProperty* Property = *PropertyIt;
+			UClass* PropertyClass = Property->GetOwnerClass();
+
+			const bool bIsDelegate = Property->IsA(FMulticastDelegateProperty::StaticClass());
+			const bool bIsExposedToSpawn = UEdGraphSchema_K2::IsPropertyExposedOnSpawn(Property);
+			const bool bIsSettableExternally = !Property->HasAnyPropertyFlags(CPF_DisableEditOnInstance);
+
+			if (bIsExposedToSpawn &&
+				!Property->HasAnyPropertyFlags(CPF_Parm) &&
+				bIsSettableExternally &&
+				Property->HasAllPropertyFlags(CPF_BlueprintVisible) &&
+				!bIsDelegate &&
+				FBlueprintEditorUtils::PropertyStillExists(Property))
+			{
+				if (PropertyClass != CurrentClass)
+				{
+					CurrentClass = PropertyClass;
+					SortedExposePropertys.Insert(CurrentClassPropertys, 0);
+					CurrentClassPropertys.Empty();
+				}
+				CurrentClassPropertys.Add(Property);
+			}
+		}
+		SortedExposePropertys.Insert(CurrentClassPropertys, 0);
+
+		Layout.ClassDefaultObject = ClassDefaultObject;
+		Layout.PinInfos.Reset(SortedExposePropertys.Num());
+		for (FProperty* Property : SortedExposePropertys)
+		{
+			FPinInfo& PinInfo = Layout.PinInfos.AddDefaulted_GetRef();
+			PinInfo.PropertyName = Property->GetFName();
+			K2Schema->ConvertPropertyToPinType(Property, /*out*/ PinInfo.PinType);
+			PinInfo.FriendlyName = Property->GetDisplayNameText();
+			PinInfo.ToolTipText = Property->GetToolTipText();
+			PinInfo.bAdvancedView = Property->HasAllPropertyFlags(CPF_AdvancedDisplay);
+			PinInfo.bHasDefaultValue = ClassDefaultObject && FBlueprintEditorUtils::PropertyValueToString(Property, reinterpret_cast<const uint8*>(ClassDefaultObject), PinInfo.DefaultValue);
+		}
+	}
+
+	const FLayout& GetLayout(UClass* InClass)
+	{
+		FLayout* Layout = CachedLayouts.Find(InClass);
+		if (Layout == nullptr)
+		{
+			Layout = &CachedLayouts.Add(InClass);
+			BuildLayout(InClass, *Layout);
+		}
+		else if (Layout->ClassDefaultObject.Get() != InClass->GetDefaultObject(false))
+		{
+			// 重新编译时的重新实例化会清空缓存，这里只处理没有替换对象的重新生成
+			BuildLayout(InClass, *Layout);
+		}
+		return *Layout;
+	}
+
+	void ClearCache()
+	{
+		CachedLayouts.Empty();
+	}
+
+	void WhenObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+	{
+		// 修改类默认值后默认值字符串失效
+		if (Object->HasAnyFlags(RF_ClassDefaultObject))
+		{
+			CachedLayouts.Remove(Object->GetClass());
+		}
+	}
+
+	void WhenObjectsReplaced(const TMap<UObject*, UObject*>& ReplacementMap)
+	{
+		ClearCache();
+	}
+
+	FDelegateHandle ObjectPropertyChangedHandle;
+	FDelegateHandle ObjectsReplacedHandle;
+}
+
+void UBpNode_AD_CreateObjectBase::RegisterPinLayoutCache()
+{
+	CreateObjectPinLayout::ObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddStatic(&CreateObjectPinLayout::WhenObjectPropertyChanged);
+	CreateObjectPinLayout::ObjectsReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddStatic(&CreateObjectPinLayout::WhenObjectsReplaced);
+}
+
+void UBpNode_AD_CreateObjectBase::UnregisterPinLayoutCache()
+{
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(CreateObjectPinLayout::ObjectPropertyChangedHandle);
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove(CreateObjectPinLayout::ObjectsReplacedHandle);
+	CreateObjectPinLayout::ClearCache();
+}
+
 #define LOCTEXT_NAMESPACE "XD_CharacterActionDispatcher_CreateActionFromClassBase"
 
 UBpNode_AD_CreateObjectBase::UBpNode_AD_CreateObjectBase(const FObjectInitializer& ObjectInitializer)
@@ -103,63 +228,32 @@ void UBpNode_AD_CreateObjectBase::CreatePinsForClass(UClass* InClass, TArray<UEd
 
 	const UEdGraphSchema_K2* K2Schema = GetDefault<UEdGraphSchema_K2>();
 
-	const UObject* const ClassDefaultObject = InClass->GetDefaultObject(false);
-
-	TArray<FProperty*> SortedExposePropertys;
-
-	TArray<FProperty*> CurrentClassPropertys;
-	UClass* CurrentClass = InClass;
-	for (TFieldIterator<FProperty> PropertyIt(InClass, EFieldIteratorFlags::IncludeSuper); PropertyIt; ++PropertyIt)
+	// 暴露属性的布局按类缓存，节点重建时不再遍历类的所有属性
+	for (const CreateObjectPinLayout::FPinInfo& PinInfo : CreateObjectPinLayout::GetLayout(InClass).PinInfos)
 	{
-		FProperty* Property = *PropertyIt;
-		UClass* PropertyClass = Property->GetOwnerClass();
-
-		const bool bIsDelegate = Property->IsA(FMulticastDelegateProperty::StaticClass());
-		const bool bIsExposedToSpawn = UEdGraphSchema_K2::IsPropertyExposedOnSpawn(Property);
-		const bool bIsSettableExternally = !Property->HasAnyPropertyFlags(CPF_DisableEditOnInstance);
-
-		if(	bIsExposedToSpawn &&
-			!Property->HasAnyPropertyFlags(CPF_Parm) && 
-			bIsSettableExternally &&
-			Property->HasAllPropertyFlags(CPF_BlueprintVisible) &&
-			!bIsDelegate &&
-			(nullptr == FindPin(Property->GetFName()) ) &&
-			FBlueprintEditorUtils::PropertyStillExists(Property))
+		if (FindPin(PinInfo.PropertyName))
 		{
-			if (PropertyClass != CurrentClass)
-			{
-				CurrentClass = PropertyClass;
-				SortedExposePropertys.Insert(CurrentClassPropertys, 0);
-				CurrentClassPropertys.Empty();
-			}
-			CurrentClassPropertys.Add(Property);
+			continue;
 		}
-	}
-	SortedExposePropertys.Insert(CurrentClassPropertys, 0);
 
-	for (FProperty* Property : SortedExposePropertys)
-	{
-		if (UEdGraphPin* Pin = CreatePin(EGPD_Input, NAME_None, Property->GetFName()))
+		if (UEdGraphPin* Pin = CreatePin(EGPD_Input, NAME_None, PinInfo.PropertyName))
 		{
-			K2Schema->ConvertPropertyToPinType(Property, /*out*/ Pin->PinType);
+			Pin->PinType = PinInfo.PinType;
 			if (OutClassPins)
 			{
 				OutClassPins->Add(Pin);
 			}
-			Pin->PinFriendlyName = Property->GetDisplayNameText();
+			Pin->PinFriendlyName = PinInfo.FriendlyName;
 
-			Pin->bAdvancedView = Property->HasAllPropertyFlags(CPF_AdvancedDisplay);
+			Pin->bAdvancedView = PinInfo.bAdvancedView;
 
-			if (ClassDefaultObject && K2Schema->PinDefaultValueIsEditable(*Pin))
+			if (PinInfo.bHasDefaultValue && K2Schema->PinDefaultValueIsEditable(*Pin))
 			{
-				FString DefaultValueAsString;
-				const bool bDefaultValueSet = FBlueprintEditorUtils::PropertyValueToString(Property, reinterpret_cast<const uint8*>(ClassDefaultObject), DefaultValueAsString, this);
-				check(bDefaultValueSet);
-				K2Schema->SetPinAutogeneratedDefaultValue(Pin, DefaultValueAsString);
+				K2Schema->SetPinAutogeneratedDefaultValue(Pin, PinInfo.DefaultValue);
 			}
 
 			// Copy tooltip from the property.
-			K2Schema->ConstructBasicPinTooltip(*Pin, Property->GetToolTipText(), Pin->PinToolTip);
+			K2Schema->ConstructBasicPinTooltip(*Pin, PinInfo.ToolTipText, Pin->PinToolTip);
 		}
 	}
 
@@ -552,24 +646,34 @@ void UBpNode_CreateActionFromClassBase::WhenClassPinChanged(UClass* NewClass)
 	ActionClass = NewClass;
 }
 
-FString UBpNode_CreateActionFromClassBase::GetActionGuidValue() const
+FString UBpNode_CreateActionFromClassBase::GetSaveActionValue() const
 {
-	return NodeGuid.ToString();
+	return GetResultPin()->LinkedTo.Num() > 0 ? TEXT("True") : TEXT("False");
 }
 
-FString UBpNode_CreateActionFromClassBase::GetSaveActionValue() const
+int32 UBpNode_CreateActionFromClassBase::RegisterActionNode(FKismetCompilerContext& CompilerContext) const
 {
-	return GetResultPin()->LinkedTo.Num() > 0 ? TEXT("True") : TEXT("False");
+	// 只有需要保存的行为才需要运行时槽位
+	if (GetResultPin()->LinkedTo.Num() > 0)
+	{
+		return DA_NodeUtils::RegisterDispatcherNode(this, CompilerContext, EActionDispatcherNodeType::Action);
+	}
+	return INDEX_NONE;
+}
+
+FString UBpNode_CreateActionFromClassBase::GetActionIndexValue(FKismetCompilerContext& CompilerContext) const
+{
+	return FString::FromInt(RegisterActionNode(CompilerContext));
 }
 
-UEdGraphPin* UBpNode_CreateActionFromClassBase::CreateInvokeActiveActionNode(UEdGraphPin* LastThen, UK2Node_CallFunction* GetMainActionDispatcherNode, UEdGraphPin* ActionRefPin, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
+UEdGraphPin* UBpNode_CreateActionFromClassBase::CreateInvokeActiveActionNode(UEdGraphPin* LastThen, UEdGraphPin* ActionRefPin, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
 {
+	// 行为保存在执行该节点的调度器中，Self引脚保持默认
 	UK2Node_CallFunction* ActiveActionNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
 	ActiveActionNode->SetFromFunction(UXD_ActionDispatcherBase::StaticClass()->FindFunctionByName(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, InvokeActiveAction)));
 	ActiveActionNode->AllocateDefaultPins();
-	GetMainActionDispatcherNode->GetReturnValuePin()->MakeLinkTo(ActiveActionNode->FindPinChecked(UEdGraphSchema_K2::PN_Self));
 	ActionRefPin->MakeLinkTo(ActiveActionNode->FindPinChecked(TEXT("Action")));
-	ActiveActionNode->FindPinChecked(TEXT("ActionGuid"))->DefaultValue = GetActionGuidValue();
+	ActiveActionNode->FindPinChecked(TEXT("ActionIndex"))->DefaultValue = GetActionIndexValue(CompilerContext);
 	ActiveActionNode->FindPinChecked(TEXT("SaveAction"))->DefaultValue = GetSaveActionValue();
 
 	LastThen->MakeLinkTo(ActiveActionNode->GetExecPin());
@@ -577,18 +681,17 @@ UEdGraphPin* UBpNode_CreateActionFromClassBase::CreateInvokeActiveActionNode(UEd
 	return LastThen;
 }
 
-void UBpNode_CreateActionFromClassBase::LinkResultPin(UK2Node_CallFunction* GetMainActionDispatcherNode, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
+void UBpNode_CreateActionFromClassBase::LinkResultPin(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
 {
 	UK2Node_CallFunction* FindActionNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
 	FindActionNode->SetFromFunction(UXD_ActionDispatcherBase::StaticClass()->FindFunctionByName(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, FindAction)));
 	FindActionNode->AllocateDefaultPins();
-	FindActionNode->FindPinChecked(TEXT("ActionGuid"))->DefaultValue = GetActionGuidValue();
+	FindActionNode->FindPinChecked(TEXT("ActionIndex"))->DefaultValue = GetActionIndexValue(CompilerContext);
 	UEdGraphPin& ResultPin = *FindActionNode->GetReturnValuePin();
 	{
 		FindActionNode->FindPinChecked(TEXT("ActionType"))->DefaultObject = ActionClass;
 		ResultPin.PinType.PinSubCategoryObject = GetResultPin()->PinType.PinSubCategoryObject;
 	}
-	FindActionNode->FindPinChecked(UEdGraphSchema_K2::PN_Self)->MakeLinkTo(GetMainActionDispatcherNode->GetReturnValuePin());
 	CompilerContext.MovePinLinksToIntermediate(*GetResultPin(), ResultPin);
 }
 
@@ -115,6 +115,14 @@ void UBpNode_ExecuteAction::ExpandNode(class FKismetCompilerContext& CompilerCon
 		return;
 	}
 
+	// 编译进原生状态表的节点只保留进入状态的入口
+	if (UK2Node_CallFunction* EnterNativeStateNode = DA_NodeUtils::ExpandNativeStateEntry(this, CompilerContext, SourceGraph))
+	{
+		DA_NodeUtils::CreateDebugEventEntryPoint(this, CompilerContext, EnterNativeStateNode->GetExecPin(), EntryPointEventName);
+		BreakAllNodeLinks();
+		return;
+	}
+
 	DA_NodeUtils::CreateDebugEventEntryPoint(this, CompilerContext, GetExecPin(), EntryPointEventName);
 
 	UK2Node_CallFunction* CallCreateNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
@@ -156,8 +164,8 @@ void UBpNode_ExecuteAction::ExpandNode(class FKismetCompilerContext& CompilerCon
 	//创建所有事件的委托
 	LastThen = CreateAllEventNode(LastThen, CallCreateNode->GetReturnValuePin(), EntryPointEventName, CompilerContext, SourceGraph);
 
-	LastThen = CreateInvokeActiveActionNode(LastThen, GetMainActionDispatcherNode, CallCreateNode->GetReturnValuePin(), CompilerContext, SourceGraph);
-	LinkResultPin(GetMainActionDispatcherNode, CompilerContext, SourceGraph);
+	LastThen = CreateInvokeActiveActionNode(LastThen, CallCreateNode->GetReturnValuePin(), CompilerContext, SourceGraph);
+	LinkResultPin(CompilerContext, SourceGraph);
 
 	bSucceeded &= CompilerContext.MovePinLinksToIntermediate(*GetThenPin(), *LastThen).CanSafeConnect();
 
@@ -17,6 +17,8 @@
 
 #include "CustomBpNode/Utils/DA_CustomBpNodeUtils.h"
 #include "Compiler/LinkToFinishNodeChecker.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
+#include <K2Node_CustomEvent.h>
 
 #define LOCTEXT_NAMESPACE "XD_CharacterActionDispatcher"
 
@@ -28,6 +30,10 @@ FText UBpNode_FlowControl_Together::GetNodeTitle(ENodeTitleType::Type TitleType)
 	{
 		return LOCTEXT("TogetherEvent Node Title", "Together Event");
 	}
+	else if (RequiredCount > 0 && RequiredCount < TogetherEventCount)
+	{
+		return FText::Format(LOCTEXT("TogetherEvent node required detail title", "共同事件[{0}/{1}]"), RequiredCount, TogetherEventCount);
+	}
 	else
 	{
 		return FText::Format(LOCTEXT("TogetherEvent node detail title", "共同事件[{0}]"), TogetherEventCount);
@@ -66,16 +72,19 @@ void UBpNode_FlowControl_Together::GetNodeContextMenuActions(class UToolMenu* Me
 	if (!Context->bIsDebugging)
 	{
 		FToolMenuSection& Section = Menu->AddSection(TEXT("FlowControl Together"), LOCTEXT("FlowControl Together", "FlowControl Together"));
-		Section.AddMenuEntry(
-			TEXT("Add FlowControl Together Event"),
-			LOCTEXT("FlowControl Together Add Pin Desc", "添加共同事件输入"),
-			LOCTEXT("FlowControl Together Add Pin Desc", "添加共同事件输入"),
-			FSlateIcon(),
-			FUIAction(
-				FExecuteAction::CreateUObject(this, &UBpNode_FlowControl_Together::AddExecPin),
-				FIsActionChecked()
-			)
-		);
+		if (TogetherEventCount < FTogetherFlowControl::MaxTogetherCount)
+		{
+			Section.AddMenuEntry(
+				TEXT("Add FlowControl Together Event"),
+				LOCTEXT("FlowControl Together Add Pin Desc", "添加共同事件输入"),
+				LOCTEXT("FlowControl Together Add Pin Desc", "添加共同事件输入"),
+				FSlateIcon(),
+				FUIAction(
+					FExecuteAction::CreateUObject(this, &UBpNode_FlowControl_Together::AddExecPin),
+					FIsActionChecked()
+				)
+			);
+		}
 
 		if (Context->Pin && TogetherEventCount > 2 && TogetherPins.Contains(Context->Pin))
 		{
@@ -106,25 +115,52 @@ void UBpNode_FlowControl_Together::ExpandNode(class FKismetCompilerContext& Comp
 {
 	Super::ExpandNode(CompilerContext, SourceGraph);
 
-	UK2Node_Knot* FinishedNode = CompilerContext.SpawnIntermediateNode<UK2Node_Knot>(this, SourceGraph);
-	FinishedNode->AllocateDefaultPins();
-	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TogetherEventPinName), *FinishedNode->GetOutputPin());
+	// 编译进原生状态表的共同事件只会由原生状态进入，已在预编译时注册
+	if (DA_NodeUtils::FindNativeState(this, CompilerContext) != INDEX_NONE)
+	{
+		BreakAllNodeLinks();
+		return;
+	}
 
-	UK2Node_CallFunction* GetMainActionDispatcherNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
+	const int32 NodeIndex = DA_NodeUtils::RegisterDispatcherNode(this, CompilerContext, EActionDispatcherNodeType::TogetherFlowControl, TogetherEventCount);
+	if (NodeIndex == INDEX_NONE)
 	{
-		GetMainActionDispatcherNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, GetMainActionDispatcher), UXD_ActionDispatcherBase::StaticClass());
-		GetMainActionDispatcherNode->AllocateDefaultPins();
+		return;
+	}
+	if (TogetherEventCount > FTogetherFlowControl::MaxTogetherCount)
+	{
+		CompilerContext.MessageLog.Error(*FString::Printf(TEXT("@@ 共同事件输入数量不得超过%d"), (int32)FTogetherFlowControl::MaxTogetherCount), this);
+		return;
 	}
 
+	UK2Node_Knot* FinishedNode = CompilerContext.SpawnIntermediateNode<UK2Node_Knot>(this, SourceGraph);
+	FinishedNode->AllocateDefaultPins();
+	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(TogetherEventPinName), *FinishedNode->GetOutputPin());
+
+	UK2Node_CustomEvent* TimeoutEventNode = nullptr;
 	for (int32 i = 0; i < TogetherEventCount; ++i)
 	{
 		UK2Node_CallFunction* CallEnterTogetherFlowControl = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(this, SourceGraph);
 		CallEnterTogetherFlowControl->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, EnterTogetherFlowControl), UXD_ActionDispatcherBase::StaticClass());
 		CallEnterTogetherFlowControl->AllocateDefaultPins();
-		GetMainActionDispatcherNode->GetReturnValuePin()->MakeLinkTo(CallEnterTogetherFlowControl->FindPinChecked(UEdGraphSchema_K2::PN_Self));
-		DA_NodeUtils::SetPinStructValue(CallEnterTogetherFlowControl->FindPinChecked(TEXT("NodeGuid")), NodeGuid);
+		CallEnterTogetherFlowControl->FindPinChecked(TEXT("NodeIndex"))->DefaultValue = FString::FromInt(NodeIndex);
 		CallEnterTogetherFlowControl->FindPinChecked(TEXT("Index"))->DefaultValue = FString::FromInt(i);
 		CallEnterTogetherFlowControl->FindPinChecked(TEXT("TogetherCount"))->DefaultValue = FString::FromInt(TogetherEventCount);
+		CallEnterTogetherFlowControl->FindPinChecked(TEXT("RequiredCount"))->DefaultValue = FString::FromInt(RequiredCount);
+		CallEnterTogetherFlowControl->FindPinChecked(TEXT("Timeout"))->DefaultValue = FString::SanitizeFloat(Timeout);
+		if (Timeout > 0.f)
+		{
+			UEdGraphPin* TimeoutEventPin = CallEnterTogetherFlowControl->FindPinChecked(TEXT("TimeoutEvent"));
+			if (TimeoutEventNode == nullptr)
+			{
+				//超时后直接执行共同事件
+				TimeoutEventNode = CompilerContext.SpawnIntermediateEventNode<UK2Node_CustomEvent>(this, TimeoutEventPin, SourceGraph);
+				TimeoutEventNode->CustomFunctionName = *FString::Printf(TEXT("WhenTogetherTimeout_[%s]"), *CompilerContext.GetGuid(this));
+				TimeoutEventNode->AllocateDefaultPins();
+				TimeoutEventNode->FindPinChecked(UEdGraphSchema_K2::PN_Then)->MakeLinkTo(FinishedNode->GetInputPin());
+			}
+			TimeoutEventNode->FindPinChecked(UK2Node_CustomEvent::DelegateOutputName)->MakeLinkTo(TimeoutEventPin);
+		}
 
 		CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(GetExecPinName(i), EGPD_Input), *CallEnterTogetherFlowControl->GetExecPin());
 
@@ -140,6 +176,14 @@ void UBpNode_FlowControl_Together::ExpandNode(class FKismetCompilerContext& Comp
 	BreakAllNodeLinks();
 }
 
+void UBpNode_FlowControl_Together::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	RequiredCount = FMath::Clamp(RequiredCount, 0, TogetherEventCount);
+	DA_NodeUtils::UpdateNode(GetBlueprint());
+}
+
 void UBpNode_FlowControl_Together::WhenCheckLinkedFinishNode(FLinkToFinishNodeChecker& Checker) const
 {
 	for (UEdGraphPin* Pin : Pins)
@@ -154,7 +198,7 @@ void UBpNode_FlowControl_Together::WhenCheckLinkedFinishNode(FLinkToFinishNodeCh
 			{
 				if (Pin->LinkedTo.Num() > 0)
 				{
-					FLinkToFinishNodeChecker::CheckForceNotConnectFinishNode(Pin, Checker.MessageLog);
+					Checker.CheckForceNotConnectFinishNode(Pin);
 				}
 				else
 				{
@@ -193,6 +237,31 @@ void UBpNode_FlowControl_Together::RemoveExecPin(const UEdGraphPin* Pin)
 	}
 }
 
+UEdGraphPin* UBpNode_FlowControl_Together::GetTogetherEventPin() const
+{
+	return FindPinChecked(TogetherEventPinName, EGPD_Output);
+}
+
+UEdGraphPin* UBpNode_FlowControl_Together::GetWaitPin(int32 Idx) const
+{
+	return FindPinChecked(GetWaitPinName(Idx), EGPD_Output);
+}
+
+int32 UBpNode_FlowControl_Together::GetExecPinIndex(const UEdGraphPin* Pin) const
+{
+	if (Pin->GetOwningNode() == this && Pin->Direction == EGPD_Input)
+	{
+		for (int32 i = 0; i < TogetherEventCount; ++i)
+		{
+			if (Pin->PinName == GetExecPinName(i))
+			{
+				return i;
+			}
+		}
+	}
+	return INDEX_NONE;
+}
+
 FName UBpNode_FlowControl_Together::GetExecPinName(int32 Idx)
 {
 	return *FString::Printf(TEXT("申请执行[%d]"), Idx + 1);
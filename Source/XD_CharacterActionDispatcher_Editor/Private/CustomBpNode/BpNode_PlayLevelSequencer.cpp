@@ -18,18 +18,21 @@
 #include <K2Node_CallFunction.h>
 #include <K2Node_Knot.h>
 #include <Tracks/MovieScene3DTransformTrack.h>
+#include <Sections/MovieScene3DTransformSection.h>
 #include <Channels/MovieSceneFloatChannel.h>
 #include <Channels/MovieSceneChannelProxy.h>
 #include <K2Node_Self.h>
 #include <K2Node_CustomEvent.h>
 #include <K2Node_MakeArray.h>
 #include <K2Node_MakeStruct.h>
+#include <AssetRegistryModule.h>
 
 #include "Action/XD_DA_PlaySequence.h"
 #include "XD_BpNodeFunctionWarpper.h"
 #include "CustomBpNode/Utils/DA_CustomBpNodeUtils.h"
 #include "Settings/XD_ActionDispatcherSettings.h"
 #include "Dispatcher/XD_ActionDispatcherBase.h"
+#include "XD_CharacterActionDispatcher_EditorUtility.h"
 
 #define LOCTEXT_NAMESPACE "CharacterActionDispatcher"
 
@@ -57,91 +60,219 @@ void FSequencerBindingOption_Customization::CustomizeHeader(TSharedRef<class IPr
 		];
 }
 
-void UBpNode_PlayLevelSequencer::RefreshSequenceData()
+namespace SequenceBindingTransform
 {
-	if (ULevelSequence* LevelSequenceRef = LevelSequence.LoadSynchronous())
+	// 读取变换轨道第一个区段在0帧的位置与旋转，通道缺失或无法求值时保持无效值
+	void ReadInitialTransform(const UMovieScene3DTransformTrack* TransformTrack, FSequencerBindingOption& BindingOption)
 	{
-		TArray<FSequencerBindingOption> PreBindingOptions = BindingOptions;
-		BindingOptions.Empty();
+		const TArray<UMovieSceneSection*>& Sections = TransformTrack->GetAllSections();
+		UMovieScene3DTransformSection* Section = Sections.Num() > 0 ? Cast<UMovieScene3DTransformSection>(Sections[0]) : nullptr;
+		if (Section == nullptr)
+		{
+			return;
+		}
+
+		// 通道顺序为位移XYZ、旋转XYZ、缩放XYZ，被屏蔽的通道不会出现在代理中，此时下标会错位
+		if (EnumHasAllFlags(Section->GetMask().GetChannels(), EMovieSceneTransformChannel::Translation | EMovieSceneTransformChannel::Rotation) == false)
+		{
+			return;
+		}
+		TArrayView<FMovieSceneFloatChannel*> FloatChannels = Section->GetChannelProxy().GetChannels<FMovieSceneFloatChannel>();
+		if (FloatChannels.Num() < 6)
+		{
+			return;
+		}
+
+		float X, Y, Z;
+		if (FloatChannels[0]->Evaluate(0, X) && FloatChannels[1]->Evaluate(0, Y) && FloatChannels[2]->Evaluate(0, Z))
+		{
+			BindingOption.Location = FVector(X, Y, Z);
+		}
 
-		//只处理了MovieSceneSequenceID::Root的可绑定信息，若需要拓展参考FSequenceBindingTree
-		UMovieScene* MovieScene = LevelSequenceRef->GetMovieScene();
-		for (int32 i = 0; i < MovieScene->GetPossessableCount(); ++i)
+		float Roll, Pitch, Yaw;
+		if (FloatChannels[3]->Evaluate(0, Roll) && FloatChannels[4]->Evaluate(0, Pitch) && FloatChannels[5]->Evaluate(0, Yaw))
 		{
-			const FMovieScenePossessable& Binding = MovieScene->GetPossessable(i);
-			if (UClass* Class = const_cast<UClass*>(Binding.GetPossessedObjectClass()))
+			BindingOption.Rotation = FRotator(Pitch, Yaw, Roll);
+		}
+	}
+}
+
+void FSequencerBindingSummary::Build(const ULevelSequence* LevelSequence, TArray<FSequencerBindingOption>& OutBindingOptions)
+{
+	//只处理了MovieSceneSequenceID::Root的可绑定信息，若需要拓展参考FSequenceBindingTree
+	UMovieScene* MovieScene = LevelSequence->GetMovieScene();
+
+	// 资源注册表收集标签时对所有序列调用，只为带有变换轨道的绑定求值
+	TMap<FGuid, const UMovieScene3DTransformTrack*> TransformTracks;
+	for (const FMovieSceneBinding& SceneBinding : MovieScene->GetBindings())
+	{
+		for (const UMovieSceneTrack* Track : SceneBinding.GetTracks())
+		{
+			if (const UMovieScene3DTransformTrack* TransformTrack = Cast<UMovieScene3DTransformTrack>(Track))
 			{
-				FSequencerBindingOption BindingOption;
-				BindingOption.PinName = Binding.GetName();
-				BindingOption.Binding = FMovieSceneObjectBindingID(Binding.GetGuid(), MovieSceneSequenceID::Root);
-				BindingOption.BindingClass = Class;
-
-				if (FSequencerBindingOption* Option = PreBindingOptions.FindByPredicate([&](const FSequencerBindingOption& E) {return E.Binding == BindingOption.Binding; }))
-				{
-					BindingOption.bIsPin = Option->bIsPin;
-				}
-
-				if (const FMovieSceneBinding* SceneBinding = MovieScene->GetBindings().FindByPredicate([&](const FMovieSceneBinding& E) {return E.GetObjectGuid() == Binding.GetGuid(); }))
-				{
-					if (UMovieScene3DTransformTrack*const* P_TransformTrack = (UMovieScene3DTransformTrack*const*)SceneBinding->GetTracks().FindByPredicate([&](UMovieSceneTrack* E) {return E->IsA<UMovieScene3DTransformTrack>(); }))
-					{
-						const UMovieScene3DTransformTrack* TransformTrack = *P_TransformTrack;
-						const TArray<UMovieSceneSection*>& Sections = TransformTrack->GetAllSections();
-						if (Sections.Num() > 0)
-						{
-							UMovieScene3DTransformSection* Section = Cast<UMovieScene3DTransformSection>(Sections[0]);
-							TArrayView<FMovieSceneFloatChannel*> FloatChannels = Section->GetChannelProxy().GetChannels<FMovieSceneFloatChannel>();
-
-							float X, Y, Z;
-							check(FloatChannels[0]->Evaluate(0, X));
-							check(FloatChannels[1]->Evaluate(0, Y));
-							check(FloatChannels[2]->Evaluate(0, Z));
-							BindingOption.Location = FVector(X, Y, Z);
-
-							float Pitch, Yaw, Roll;
-							check(FloatChannels[4]->Evaluate(0, Pitch));
-							check(FloatChannels[5]->Evaluate(0, Yaw));
-							check(FloatChannels[6]->Evaluate(0, Roll));
-
-							BindingOption.Rotation = FRotator(Pitch, Yaw, Roll);
-						}
-					}
-				}
-
-				BindingOptions.Add(BindingOption);
+				TransformTracks.Add(SceneBinding.GetObjectGuid(), TransformTrack);
+				break;
 			}
 		}
-		for (int32 Index = 0; Index < MovieScene->GetSpawnableCount(); ++Index)
+	}
+
+	for (int32 i = 0; i < MovieScene->GetPossessableCount(); ++i)
+	{
+		const FMovieScenePossessable& Binding = MovieScene->GetPossessable(i);
+		if (UClass* Class = const_cast<UClass*>(Binding.GetPossessedObjectClass()))
 		{
-			const FMovieSceneSpawnable& Spawnable = MovieScene->GetSpawnable(Index);
-			if (const UObject* Template = Spawnable.GetObjectTemplate())
+			FSequencerBindingOption BindingOption;
+			BindingOption.PinName = Binding.GetName();
+			BindingOption.Binding = FMovieSceneObjectBindingID(Binding.GetGuid(), MovieSceneSequenceID::Root);
+			BindingOption.BindingClass = Class;
+
+			if (const UMovieScene3DTransformTrack* const* TransformTrack = TransformTracks.Find(Binding.GetGuid()))
 			{
-				FSequencerBindingOption BindingOption;
-				BindingOption.PinName = TEXT("[生成模板]") + Spawnable.GetName();
-				BindingOption.Binding = FMovieSceneObjectBindingID(Spawnable.GetGuid(), MovieSceneSequenceID::Root);
-				BindingOption.BindingClass = Template->GetClass();
+				SequenceBindingTransform::ReadInitialTransform(*TransformTrack, BindingOption);
+			}
 
-				if (FSequencerBindingOption* Option = PreBindingOptions.FindByPredicate([&](const FSequencerBindingOption& E) {return E.Binding == BindingOption.Binding; }))
-				{
-					BindingOption.bIsPin = Option->bIsPin;
-				}
+			OutBindingOptions.Add(BindingOption);
+		}
+	}
+	for (int32 Index = 0; Index < MovieScene->GetSpawnableCount(); ++Index)
+	{
+		const FMovieSceneSpawnable& Spawnable = MovieScene->GetSpawnable(Index);
+		if (const UObject* Template = Spawnable.GetObjectTemplate())
+		{
+			FSequencerBindingOption BindingOption;
+			BindingOption.PinName = TEXT("[生成模板]") + Spawnable.GetName();
+			BindingOption.Binding = FMovieSceneObjectBindingID(Spawnable.GetGuid(), MovieSceneSequenceID::Root);
+			BindingOption.BindingClass = Template->GetClass();
 
-				BindingOptions.Add(BindingOption);
-			}
+			OutBindingOptions.Add(BindingOption);
 		}
+	}
+}
+
+FString FSequencerBindingSummary::ExportToString() const
+{
+	FString Value;
+	StaticStruct()->ExportText(Value, this, nullptr, nullptr, PPF_None, nullptr);
+	return Value;
+}
 
-		for (FSequencerBindingOption& PreOption : PreBindingOptions)
+bool FSequencerBindingSummary::ImportFromString(const FString& Value)
+{
+	return StaticStruct()->ImportText(*Value, this, nullptr, PPF_None, GWarn, StaticStruct()->GetName()) != nullptr && Version == CurrentVersion;
+}
+
+namespace SequenceBindingTags
+{
+	void WhenGetExtraObjectTags(const UObject* Object, TArray<UObject::FAssetRegistryTag>& OutTags)
+	{
+		if (const ULevelSequence* LevelSequence = Cast<ULevelSequence>(Object))
 		{
-			if (PreOption.bIsPin && !BindingOptions.ContainsByPredicate([&](const FSequencerBindingOption& E) {return E.Binding == PreOption.Binding; }))
+			if (LevelSequence->GetMovieScene())
 			{
-				PreOption.bIsPin = false;
-				UpdatePinInfo(PreOption);
+				FSequencerBindingSummary Summary;
+				Summary.Version = FSequencerBindingSummary::CurrentVersion;
+				FSequencerBindingSummary::Build(LevelSequence, Summary.BindingOptions);
+				OutTags.Add(UObject::FAssetRegistryTag(FSequencerBindingSummary::GetRegistryName(), Summary.ExportToString(), UObject::FAssetRegistryTag::TT_Hidden));
 			}
 		}
-		ReflushNode();
+	}
+
+	FDelegateHandle GetExtraObjectTagsHandle;
+}
+
+void UBpNode_PlayLevelSequencer::RegisterSequenceBindingTags()
+{
+	SequenceBindingTags::GetExtraObjectTagsHandle = UObject::FAssetRegistryTag::OnGetExtraObjectTags.AddStatic(&SequenceBindingTags::WhenGetExtraObjectTags);
+}
+
+void UBpNode_PlayLevelSequencer::UnregisterSequenceBindingTags()
+{
+	UObject::FAssetRegistryTag::OnGetExtraObjectTags.Remove(SequenceBindingTags::GetExtraObjectTagsHandle);
+}
+
+void UBpNode_PlayLevelSequencer::RefreshSequenceData()
+{
+	if (LevelSequence.IsNull())
+	{
+		return;
+	}
+
+	// 已加载时直接读取，不需要等待
+	if (ULevelSequence* LevelSequenceRef = LevelSequence.Get())
+	{
+		TArray<FSequencerBindingOption> NewBindingOptions;
+		FSequencerBindingSummary::Build(LevelSequenceRef, NewBindingOptions);
+		ApplyBindingOptions(MoveTemp(NewBindingOptions));
+		return;
+	}
+
+	const FSoftObjectPath SequencePath = LevelSequence.ToSoftObjectPath();
+	const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	const FAssetData AssetData = AssetRegistry.GetAssetByObjectPath(SequencePath.GetAssetPathName());
+	FString SummaryValue;
+	if (AssetData.GetTagValue(FSequencerBindingSummary::GetRegistryName(), SummaryValue))
+	{
+		FSequencerBindingSummary Summary;
+		if (Summary.ImportFromString(SummaryValue))
+		{
+			ApplyBindingOptions(MoveTemp(Summary.BindingOptions));
+			return;
+		}
+	}
+
+	// 旧资源没有摘要，异步加载，保存Sequence后会写入摘要
+	bIsLoadingSequenceData = true;
+	LoadPackageAsync(SequencePath.GetLongPackageName(), FLoadPackageAsyncDelegate::CreateUObject(this, &UBpNode_PlayLevelSequencer::WhenSequenceLoaded, SequencePath));
+	GetGraph()->NotifyGraphChanged();
+}
+
+void UBpNode_PlayLevelSequencer::WhenSequenceLoaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result, FSoftObjectPath RequestSequencePath)
+{
+	// 加载期间修改了Sequence的请求由新的刷新处理
+	if (RequestSequencePath != LevelSequence.ToSoftObjectPath())
+	{
+		return;
+	}
+	bIsLoadingSequenceData = false;
+
+	if (ULevelSequence* LevelSequenceRef = LevelSequence.Get())
+	{
+		TArray<FSequencerBindingOption> NewBindingOptions;
+		FSequencerBindingSummary::Build(LevelSequenceRef, NewBindingOptions);
+		ApplyBindingOptions(MoveTemp(NewBindingOptions));
+	}
+	else
+	{
+		ActionDispatcher_Editor_Warning_LOG("加载Sequence[%s]失败", *RequestSequencePath.ToString());
+		GetGraph()->NotifyGraphChanged();
 	}
 }
 
+void UBpNode_PlayLevelSequencer::ApplyBindingOptions(TArray<FSequencerBindingOption>&& NewBindingOptions)
+{
+	bIsLoadingSequenceData = false;
+
+	TArray<FSequencerBindingOption> PreBindingOptions = MoveTemp(BindingOptions);
+	BindingOptions = MoveTemp(NewBindingOptions);
+	for (FSequencerBindingOption& BindingOption : BindingOptions)
+	{
+		if (FSequencerBindingOption* Option = PreBindingOptions.FindByPredicate([&](const FSequencerBindingOption& E) {return E.Binding == BindingOption.Binding; }))
+		{
+			BindingOption.bIsPin = Option->bIsPin;
+		}
+	}
+
+	for (FSequencerBindingOption& PreOption : PreBindingOptions)
+	{
+		if (PreOption.bIsPin && !BindingOptions.ContainsByPredicate([&](const FSequencerBindingOption& E) {return E.Binding == PreOption.Binding; }))
+		{
+			PreOption.bIsPin = false;
+			UpdatePinInfo(PreOption);
+		}
+	}
+	ReflushNode();
+}
+
 void UBpNode_PlayLevelSequencer::AllocateDefaultPins()
 {
 	Super::AllocateDefaultPins();
@@ -159,6 +290,7 @@ void UBpNode_PlayLevelSequencer::ShowExtendPins(UClass* UseSpawnClass)
 }
 
 UBpNode_PlayLevelSequencer::UBpNode_PlayLevelSequencer()
+	:bIsLoadingSequenceData(false)
 {
 	ActionClass = UXD_DA_PlaySequenceBase::StaticClass();
 }
@@ -198,7 +330,12 @@ FText UBpNode_PlayLevelSequencer::GetNodeTitle(ENodeTitleType::Type TitleType) c
 	}
 	else
 	{
-		return FText::Format(LOCTEXT("PlaySequence detail title", "[{0}]({1})"), ActionClass ? ActionClass->GetDisplayNameText() : EmptyName, FText::FromString(LevelSequence.IsNull() ? TEXT("None") : LevelSequence.GetAssetName()));
+		const FText Title = FText::Format(LOCTEXT("PlaySequence detail title", "[{0}]({1})"), ActionClass ? ActionClass->GetDisplayNameText() : EmptyName, FText::FromString(LevelSequence.IsNull() ? TEXT("None") : LevelSequence.GetAssetName()));
+		if (bIsLoadingSequenceData)
+		{
+			return FText::Format(LOCTEXT("PlaySequence loading title", "{0}\n读取Sequence数据中..."), Title);
+		}
+		return Title;
 	}
 }
 
@@ -298,8 +435,8 @@ void UBpNode_PlayLevelSequencer::ExpandNode(class FKismetCompilerContext& Compil
  	}
 
 	LastThen = CreateAllEventNode(LastThen, CreatePlaySequenceNode->GetReturnValuePin(), EntryPointEventName, CompilerContext, SourceGraph);
-	LastThen = CreateInvokeActiveActionNode(LastThen, GetMainActionDispatcherNode, CreatePlaySequenceNode->GetReturnValuePin(), CompilerContext, SourceGraph);
-	LinkResultPin(GetMainActionDispatcherNode, CompilerContext, SourceGraph);
+	LastThen = CreateInvokeActiveActionNode(LastThen, CreatePlaySequenceNode->GetReturnValuePin(), CompilerContext, SourceGraph);
+	LinkResultPin(CompilerContext, SourceGraph);
 
 	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(UEdGraphSchema_K2::PN_Then), *LastThen);
 }
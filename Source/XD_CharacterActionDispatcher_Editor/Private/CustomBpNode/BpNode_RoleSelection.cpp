@@ -150,8 +150,11 @@ void UBpNode_RoleSelection::ExpandNode(class FKismetCompilerContext& CompilerCon
 	CallShowSelectionNode->AllocateDefaultPins();
 	CallShowSelectionNode->FindPinChecked(UEdGraphSchema_K2::PN_Self)->MakeLinkTo(CallCreateNode->GetReturnValuePin());
 	CallShowSelectionNode->FindPinChecked(TEXT("SaveAction"))->DefaultValue = GetSaveActionValue();
-	CallShowSelectionNode->FindPinChecked(TEXT("ActionGuid"))->DefaultValue = GetActionGuidValue();
-	GetMainActionDispatcherNode->GetReturnValuePin()->MakeLinkTo(CallShowSelectionNode->FindPinChecked(TEXT("ActionDispatcher")));
+	CallShowSelectionNode->FindPinChecked(TEXT("ActionIndex"))->DefaultValue = GetActionIndexValue(CompilerContext);
+	// 行为保存在执行该节点的调度器中
+	UK2Node_Self* SelfNode = CompilerContext.SpawnIntermediateNode<UK2Node_Self>(this, SourceGraph);
+	SelfNode->AllocateDefaultPins();
+	SelfNode->FindPinChecked(UEdGraphSchema_K2::PN_Self)->MakeLinkTo(CallShowSelectionNode->FindPinChecked(TEXT("ActionDispatcher")));
 	LastThen->MakeLinkTo(CallShowSelectionNode->GetExecPin());
 
 	CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(UEdGraphSchema_K2::PN_Then), *CallShowSelectionNode->GetThenPin());
@@ -197,7 +200,7 @@ void UBpNode_RoleSelection::ExpandNode(class FKismetCompilerContext& CompilerCon
 		CompilerContext.MovePinLinksToIntermediate(*FindPinChecked(GetShowSelectionConditionName(i), EGPD_Input), *MakeShowSelectionConditionsArrayNode->FindPinChecked(*FString::Printf(TEXT("[%d]"), i), EGPD_Input));
 	}
 
-	LinkResultPin(GetMainActionDispatcherNode, CompilerContext, SourceGraph);
+	LinkResultPin(CompilerContext, SourceGraph);
 
 	BreakAllNodeLinks();
 }
@@ -37,7 +37,7 @@ void UBpNode_StartDispatcherBase::AllocateDefaultPins()
 void UBpNode_StartDispatcherBase::ShowExtendPins(UClass* UseSpawnClass)
 {
 	Super::ShowExtendPins(UseSpawnClass);
-	GetClassPin()->DefaultObject = ActionDispatcherClass;
+	GetClassPin()->DefaultObject = ActionDispatcherClass.Get();
 	GetResultPin()->PinType.PinSubCategoryObject = UseSpawnClass;
 }
 
@@ -50,7 +50,7 @@ void UBpNode_StartDispatcherBase::WhenClassPinChanged(UClass* NewClass)
 void UBpNode_StartDispatcherBase::ExpandNode(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
 {
 	Super::ExpandNode(CompilerContext, SourceGraph);
-	if (ActionDispatcherClass == nullptr)
+	if (ActionDispatcherClass.LoadSynchronous() == nullptr)
 	{
 		CompilerContext.MessageLog.Error(*LOCTEXT("开始调度器_类型为空Error", "ICE: @@类型不得为空").ToString(), this);
 		return;
@@ -69,14 +69,7 @@ bool UBpNode_StartDispatcherBase::IsSpawnVarPin(UEdGraphPin* Pin) const
 
 void UBpNode_StartDispatcherBase::ReflushFinishExec()
 {
-	if (ActionDispatcherClass)
-	{
-		FinishedTags = ActionDispatcherClass.GetDefaultObject()->GetAllFinishTags();
-	}
-	else
-	{
-		FinishedTags.Empty();
-	}
+	FinishedTags = DA_NodeUtils::GetDispatcherFinishTags(ActionDispatcherClass);
 	for (const FName& Tag : FinishedTags)
 	{
 		CreatePin(EGPD_Output, UEdGraphSchema_K2::PC_Exec, Tag);
@@ -336,7 +329,7 @@ void UBpNode_StartDispatcherWithOwner::AllocateDefaultPins()
 	FCreatePinParams CreatePinParams;
 	CreatePinParams.bIsReference = true;
 	CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Object, UObject::StaticClass(), OwnerPinName);
-	CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Object, ActionDispatcherClass ? *ActionDispatcherClass : UXD_ActionDispatcherBase::StaticClass(), Dispatcher_MemberVarPinName, CreatePinParams);
+	CreatePin(EGPD_Input, UEdGraphSchema_K2::PC_Object, ActionDispatcherClass.Get() ? ActionDispatcherClass.Get() : UXD_ActionDispatcherBase::StaticClass(), Dispatcher_MemberVarPinName, CreatePinParams);
 }
 
 void UBpNode_StartDispatcherWithOwner::ExpandNode(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
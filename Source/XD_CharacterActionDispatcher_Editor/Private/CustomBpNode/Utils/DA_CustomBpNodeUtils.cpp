@@ -22,6 +22,9 @@
 #include "K2Node_EnumLiteral.h"
 #include <ToolMenu.h>
 #include <ToolMenuSection.h>
+#include "Compiler/ActionDispatcherBP_Compiler.h"
+#include "Blueprint/ActionDispatcherBlueprint.h"
+#include <AssetRegistryModule.h>
 
 #define LOCTEXT_NAMESPACE "XD_CharacterActionDispatcher"
 
@@ -41,6 +44,91 @@ void DA_NodeUtils::UpdateNode(UBlueprint* Blueprint)
 	}
 }
 
+int32 DA_NodeUtils::RegisterDispatcherNode(const UEdGraphNode* Node, FKismetCompilerContext& CompilerContext, EActionDispatcherNodeType NodeType, int32 TogetherCount)
+{
+	if (FActionDispatcherBP_Compiler* ActionDispatcherCompiler = FActionDispatcherBP_Compiler::Get(CompilerContext))
+	{
+		return ActionDispatcherCompiler->RegisterDispatcherNode(Node, NodeType, TogetherCount);
+	}
+	CompilerContext.MessageLog.Error(TEXT("@@ 只能在行为调度器蓝图中使用"), Node);
+	return INDEX_NONE;
+}
+
+int32 DA_NodeUtils::FindNativeState(const UEdGraphNode* Node, FKismetCompilerContext& CompilerContext)
+{
+	if (FActionDispatcherBP_Compiler* ActionDispatcherCompiler = FActionDispatcherBP_Compiler::Get(CompilerContext))
+	{
+		return ActionDispatcherCompiler->FindNativeState(Node);
+	}
+	return INDEX_NONE;
+}
+
+UK2Node_CallFunction* DA_NodeUtils::ExpandNativeStateEntry(UK2Node* Node, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph)
+{
+	const int32 StateIndex = FindNativeState(Node, CompilerContext);
+	if (StateIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	UK2Node_CallFunction* EnterNativeStateNode = CompilerContext.SpawnIntermediateNode<UK2Node_CallFunction>(Node, SourceGraph);
+	EnterNativeStateNode->FunctionReference.SetExternalMember(GET_FUNCTION_NAME_CHECKED(UXD_ActionDispatcherBase, EnterNativeState), UXD_ActionDispatcherBase::StaticClass());
+	EnterNativeStateNode->AllocateDefaultPins();
+	EnterNativeStateNode->FindPinChecked(TEXT("StateIndex"))->DefaultValue = FString::FromInt(StateIndex);
+	CompilerContext.MovePinLinksToIntermediate(*CompilerContext.GetSchema()->FindExecutionPin(*Node, EGPD_Input), *EnterNativeStateNode->GetExecPin());
+	return EnterNativeStateNode;
+}
+
+bool DA_NodeUtils::IsPinDefaultValueMatchClass(FKismetCompilerContext& CompilerContext, const UEdGraphPin* Pin, const UClass* ForClass, FProperty* Property)
+{
+	FString DefaultValueAsString;
+	if (FBlueprintCompilationManager::GetDefaultValue(ForClass, Property, DefaultValueAsString))
+	{
+		return CompilerContext.GetSchema()->DoesDefaultValueMatch(*Pin, DefaultValueAsString);
+	}
+	else if (ForClass->ClassDefaultObject)
+	{
+		FBlueprintEditorUtils::PropertyValueToString(Property, (uint8*)ForClass->ClassDefaultObject, DefaultValueAsString);
+		return DefaultValueAsString == Pin->GetDefaultAsString();
+	}
+	return false;
+}
+
+TArray<FName> DA_NodeUtils::GetDispatcherFinishTags(const TSoftClassPtr<UXD_ActionDispatcherBase>& DispatcherClass)
+{
+	TArray<FName> FinishTags;
+	if (DispatcherClass.IsNull())
+	{
+		return FinishTags;
+	}
+
+	// 已加载的资源返回内存中的标签，未加载的返回磁盘上的标签，不会加载调度器类
+	const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	TArray<FAssetData> AssetDatas;
+	AssetRegistry.GetAssetsByPackageName(*DispatcherClass.GetLongPackageName(), AssetDatas);
+	for (const FAssetData& AssetData : AssetDatas)
+	{
+		FString FinishTagsValue;
+		if (AssetData.GetTagValue(UActionDispatcherBlueprint::GetFinishTagsRegistryName(), FinishTagsValue))
+		{
+			TArray<FString> FinishTagStrings;
+			FinishTagsValue.ParseIntoArray(FinishTagStrings, TEXT(","));
+			for (const FString& FinishTagString : FinishTagStrings)
+			{
+				FinishTags.Add(*FinishTagString);
+			}
+			return FinishTags;
+		}
+	}
+
+	const UClass* LoadedClass = DispatcherClass.Get();
+	if (LoadedClass && LoadedClass->ClassGeneratedBy)
+	{
+		FinishTags = LoadedClass->GetDefaultObject<UXD_ActionDispatcherBase>()->GetAllFinishTags();
+	}
+	return FinishTags;
+}
+
 void DA_NodeUtils::CreateDebugEventEntryPoint(UEdGraphNode* SourceNode, FKismetCompilerContext& CompilerContext, UEdGraphPin* ExecPin, const FName& EventName)
 {
 	UBpNode_DebugEntryPointEvent* DebugEvent = CompilerContext.SpawnIntermediateEventNode<UBpNode_DebugEntryPointEvent>(SourceNode, nullptr, nullptr);
@@ -139,23 +227,9 @@ UEdGraphPin* DA_NodeUtils::GenerateAssignmentNodes(class FKismetCompilerContext&
 
 				// We don't want to generate an assignment node unless the default value 
 				// differs from the value in the CDO:
-				FString DefaultValueAsString;
-
-				if (FBlueprintCompilationManager::GetDefaultValue(ForClass, Property, DefaultValueAsString))
+				if (IsPinDefaultValueMatchClass(CompilerContext, OrgPin, ForClass, Property))
 				{
-					if (Schema->DoesDefaultValueMatch(*OrgPin, DefaultValueAsString))
-					{
-						continue;
-					}
-				}
-				else if (ForClass->ClassDefaultObject)
-				{
-					FBlueprintEditorUtils::PropertyValueToString(Property, (uint8*)ForClass->ClassDefaultObject, DefaultValueAsString);
-
-					if (DefaultValueAsString == OrgPin->GetDefaultAsString())
-					{
-						continue;
-					}
+					continue;
 				}
 			}
 
@@ -14,6 +14,7 @@
 #include "Compiler/ActionDispatcherBP_Compiler.h"
 #include "Blueprint/ActionDispatcherBlueprint.h"
 #include "GraphEditor/ActionDispatcher_AssetActions.h"
+#include "CustomBpNode/BpNode_CreateActionFromClassBase.h"
 
 #define LOCTEXT_NAMESPACE "FXD_CharacterActionDispatcher_EditorModule"
 
@@ -33,6 +34,9 @@ void FXD_CharacterActionDispatcher_EditorModule::StartupModule()
 
 	FKismetCompilerContext::RegisterCompilerForBP(UActionDispatcherBlueprint::StaticClass(), &FXD_CharacterActionDispatcher_EditorModule::GetCompilerForBP);
 
+	UBpNode_AD_CreateObjectBase::RegisterPinLayoutCache();
+	UBpNode_PlayLevelSequencer::RegisterSequenceBindingTags();
+
 	{
 		// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
 
@@ -67,6 +71,9 @@ void FXD_CharacterActionDispatcher_EditorModule::ShutdownModule()
 	//Unregister the style
 	FSlateStyleRegistry::UnRegisterSlateStyle(StyleSet->GetStyleSetName());
 
+	UBpNode_AD_CreateObjectBase::UnregisterPinLayoutCache();
+	UBpNode_PlayLevelSequencer::UnregisterSequenceBindingTags();
+
 	if (FModuleManager::Get().IsModuleLoaded("AssetTools"))
 	{
 		IAssetTools& AssetTools = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools").Get();
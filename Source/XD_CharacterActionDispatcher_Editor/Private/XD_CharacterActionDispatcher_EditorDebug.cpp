@@ -0,0 +1,354 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+#include <HAL/IConsoleManager.h>
+#include <UObject/UObjectIterator.h>
+#include <UObject/Package.h>
+#include <Math/RandomStream.h>
+#include <Engine/World.h>
+#include <GameFramework/GameStateBase.h>
+#include <AssetRegistryModule.h>
+#include <EdGraph/EdGraph.h>
+#include <EdGraphSchema_K2.h>
+#include <K2Node_ExecutionSequence.h>
+#include <Kismet2/CompilerResultsLog.h>
+
+#include "Blueprint/ActionDispatcherBlueprint.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
+#include "Dispatcher/XD_ActionDispatcherBase.h"
+#include "Action/XD_DispatchableActionBase.h"
+#include "Manager/XD_ActionDispatcherManager.h"
+#include "Compiler/ActionDispatcherBP_Compiler.h"
+#include "Compiler/LinkToFinishNodeChecker.h"
+#include "CustomBpNode/BpNode_FinishDispatch.h"
+#include "CustomBpNode/BpNode_FlowControl_Together.h"
+
+// 编辑器中使用的调试与压力测试命令，只用于本地排查，不作为正确性检查
+// 节点序号的检查由ActionDispatcherValidate命令行执行
+
+// 检查已加载的调度器蓝图的节点序号，与检查命令行使用同一套规则
+struct FActionDispatcherNodeIndexCheck
+{
+	static void Run(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		// 指定路径时先加载路径下的调度器蓝图
+		if (Args.Num() > 0)
+		{
+			IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+			FARFilter Filter;
+			Filter.ClassNames.Add(UActionDispatcherBlueprint::StaticClass()->GetFName());
+			Filter.bRecursiveClasses = true;
+			Filter.PackagePaths.Add(*Args[0]);
+			Filter.bRecursivePaths = true;
+			TArray<FAssetData> AssetDatas;
+			AssetRegistry.GetAssets(Filter, AssetDatas);
+			for (const FAssetData& AssetData : AssetDatas)
+			{
+				AssetData.GetAsset();
+			}
+		}
+
+		int32 ClassNum = 0;
+		int32 ChildClassNum = 0;
+		int32 ErrorNum = 0;
+		for (TObjectIterator<UActionDispatcherGeneratedClass> It; It; ++It)
+		{
+			const UActionDispatcherGeneratedClass* GeneratedClass = *It;
+			if (!GeneratedClass->HasCompiledData() || GeneratedClass->HasAnyClassFlags(CLASS_NewerVersionExists))
+			{
+				continue;
+			}
+			ClassNum += 1;
+			ChildClassNum += UActionDispatcherGeneratedClass::FindParentCompiledClass(GeneratedClass->GetSuperClass()) ? 1 : 0;
+
+			FCompilerResultsLog MessageLog;
+			MessageLog.bSilentMode = true;
+			FActionDispatcherBP_Compiler::ValidateNodeIndices(GeneratedClass, MessageLog);
+			for (const TSharedRef<FTokenizedMessage>& Message : MessageLog.Messages)
+			{
+				Ar.Logf(TEXT("%s: %s"), *GeneratedClass->GetName(), *Message->ToText().ToString());
+			}
+			ErrorNum += MessageLog.NumErrors;
+		}
+		Ar.Logf(TEXT("检查调度器类%d 其中子类%d 错误%d"), ClassNum, ChildClassNum, ErrorNum);
+	}
+};
+
+// 在临时图表上生成共同事件链，所有等待引脚共享同一段等待节点链，测试完成节点检查的耗时
+struct FLinkToFinishNodeCheckerBenchmark
+{
+	template<typename TNode>
+	static TNode* SpawnNode(UEdGraph* Graph)
+	{
+		TNode* Node = NewObject<TNode>(Graph);
+		Graph->AddNode(Node, false, false);
+		Node->CreateNewGuid();
+		Node->AllocateDefaultPins();
+		return Node;
+	}
+
+	static TArray<UEdGraphPin*> GetExecInputPins(UEdGraphNode* Node)
+	{
+		TArray<UEdGraphPin*> ExecInputPins;
+		for (UEdGraphPin* Pin : Node->Pins)
+		{
+			if (Pin->Direction == EGPD_Input && Pin->PinType.PinCategory == UEdGraphSchema_K2::PC_Exec)
+			{
+				ExecInputPins.Add(Pin);
+			}
+		}
+		return ExecInputPins;
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const int32 NodeNum = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 2000;
+		// 一半节点为共同事件与顺序节点交替的主链，一半为共享的等待链
+		const int32 SegmentNum = NodeNum / 4;
+		const int32 WaitChainNum = NodeNum - SegmentNum * 2;
+
+		UEdGraph* Graph = NewObject<UEdGraph>(GetTransientPackage());
+		Graph->Schema = UEdGraphSchema_K2::StaticClass();
+
+		TArray<UK2Node_ExecutionSequence*> WaitChain;
+		for (int32 Idx = 0; Idx < WaitChainNum; ++Idx)
+		{
+			UK2Node_ExecutionSequence* WaitNode = SpawnNode<UK2Node_ExecutionSequence>(Graph);
+			if (WaitChain.Num() > 0)
+			{
+				WaitChain.Last()->GetThenPinGivenIndex(0)->MakeLinkTo(WaitNode->GetExecPin());
+			}
+			WaitChain.Add(WaitNode);
+		}
+
+		UK2Node_ExecutionSequence* StartNode = SpawnNode<UK2Node_ExecutionSequence>(Graph);
+		UK2Node_ExecutionSequence* SequenceNode = StartNode;
+		for (int32 Idx = 0; Idx < SegmentNum; ++Idx)
+		{
+			UBpNode_FlowControl_Together* TogetherNode = SpawnNode<UBpNode_FlowControl_Together>(Graph);
+			const TArray<UEdGraphPin*> TogetherInputPins = GetExecInputPins(TogetherNode);
+			SequenceNode->GetThenPinGivenIndex(0)->MakeLinkTo(TogetherInputPins[0]);
+			SequenceNode->GetThenPinGivenIndex(1)->MakeLinkTo(TogetherInputPins[1]);
+			for (int32 PinIdx = 0; PinIdx < TogetherNode->GetTogetherEventCount(); ++PinIdx)
+			{
+				TogetherNode->GetWaitPin(PinIdx)->MakeLinkTo(WaitChain[0]->GetExecPin());
+			}
+
+			SequenceNode = SpawnNode<UK2Node_ExecutionSequence>(Graph);
+			TogetherNode->GetTogetherEventPin()->MakeLinkTo(SequenceNode->GetExecPin());
+		}
+		UBpNode_FinishDispatch* FinishNode = SpawnNode<UBpNode_FinishDispatch>(Graph);
+		SequenceNode->GetThenPinGivenIndex(0)->MakeLinkTo(FinishNode->GetExecPin());
+		SequenceNode->GetThenPinGivenIndex(1)->MakeLinkTo(FinishNode->GetExecPin());
+
+		FCompilerResultsLog MessageLog;
+		MessageLog.bSilentMode = true;
+		const double StartTime = FPlatformTime::Seconds();
+		const FLinkToFinishNodeChecker Checker = FLinkToFinishNodeChecker::CheckForceConnectFinishNode(StartNode, MessageLog);
+		const double EndTime = FPlatformTime::Seconds();
+
+		Ar.Logf(TEXT("节点数%d 共同事件%d 等待链长度%d"), Graph->Nodes.Num(), SegmentNum, WaitChainNum);
+		Ar.Logf(TEXT("%-24s %10.3f ms"), TEXT("CheckForceConnect"), (EndTime - StartTime) * 1000.0);
+		Ar.Logf(TEXT("访问节点%d 错误%d 警告%d"), Checker.VisitedNodes.Num(), MessageLog.NumErrors, MessageLog.NumWarnings);
+
+		Graph->MarkPendingKill();
+	}
+};
+
+// 管理器激活列表与等待队列的压力测试，不依赖场景，在临时管理器上执行
+struct FActionDispatcherManagerBenchmark
+{
+	static UClass* FindConcreteDispatcherClass()
+	{
+		for (TObjectIterator<UClass> It; It; ++It)
+		{
+			UClass* Class = *It;
+			if (Class->IsChildOf(UXD_ActionDispatcherBase::StaticClass()) && !Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists)
+				&& !Class->GetName().StartsWith(TEXT("SKEL_")) && !Class->GetName().StartsWith(TEXT("REINST_")))
+			{
+				return Class;
+			}
+		}
+		return nullptr;
+	}
+
+	static void Shuffle(TArray<UXD_ActionDispatcherBase*>& Dispatchers, FRandomStream& RandomStream)
+	{
+		for (int32 Idx = Dispatchers.Num() - 1; Idx > 0; --Idx)
+		{
+			Dispatchers.Swap(Idx, RandomStream.RandRange(0, Idx));
+		}
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const int32 DispatcherNum = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000;
+		UClass* DispatcherClass = FindConcreteDispatcherClass();
+		if (DispatcherClass == nullptr)
+		{
+			Ar.Logf(TEXT("未找到可实例化的行为调度器类，请先加载调度器蓝图"));
+			return;
+		}
+
+		UXD_ActionDispatcherManager* Manager = NewObject<UXD_ActionDispatcherManager>(GetTransientPackage());
+		TArray<UXD_ActionDispatcherBase*> Dispatchers;
+		Dispatchers.Reserve(DispatcherNum);
+		for (int32 Idx = 0; Idx < DispatcherNum; ++Idx)
+		{
+			Dispatchers.Add(NewObject<UXD_ActionDispatcherBase>(Manager, DispatcherClass));
+		}
+		FRandomStream RandomStream(DispatcherNum);
+
+		double StartTime = FPlatformTime::Seconds();
+		auto LogPhase = [&](const TCHAR* PhaseName)
+		{
+			const double EndTime = FPlatformTime::Seconds();
+			Ar.Logf(TEXT("%-24s %10.3f ms"), PhaseName, (EndTime - StartTime) * 1000.0);
+			StartTime = EndTime;
+		};
+
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Manager->AddPendingDispatcher(Dispatcher);
+		}
+		LogPhase(TEXT("AddPending"));
+
+		// 模拟TryActivePendingDispatcher与Tick中的压缩
+		Shuffle(Dispatchers, RandomStream);
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Manager->RemovePendingDispatcher(Dispatcher);
+			Manager->AddActivedDispatcher(Dispatcher);
+			if (Manager->PendingHoleNum * 2 > Manager->PendingDispatchers.Num())
+			{
+				Manager->CompactPendingDispatchers();
+			}
+		}
+		LogPhase(TEXT("PendingToActived"));
+
+		// 模拟WhenDispatcherDeactived
+		Shuffle(Dispatchers, RandomStream);
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Manager->RemoveActivedDispatcher(Dispatcher);
+			Manager->AddPendingDispatcher(Dispatcher);
+		}
+		LogPhase(TEXT("ActivedToPending"));
+
+		Shuffle(Dispatchers, RandomStream);
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Manager->RemovePendingDispatcher(Dispatcher);
+			Manager->AddActivedDispatcher(Dispatcher);
+		}
+		Manager->CompactPendingDispatchers();
+		StartTime = FPlatformTime::Seconds();
+
+		// 模拟WhenDispatcherFinished
+		Shuffle(Dispatchers, RandomStream);
+		for (UXD_ActionDispatcherBase* Dispatcher : Dispatchers)
+		{
+			Manager->RemoveActivedDispatcher(Dispatcher);
+		}
+		LogPhase(TEXT("Finish"));
+
+		check(Manager->ActivedDispatchers.Num() == 0 && Manager->GetPendingDispatcherNum() == 0);
+		Ar.Logf(TEXT("调度器类%s 数量%d"), *DispatcherClass->GetName(), DispatcherNum);
+	}
+};
+
+// 按类统计当前世界中行为调度器与行为的内存占用
+struct FActionDispatcherMemoryReport
+{
+	struct FClassMemoryStat
+	{
+		int32 Num = 0;
+		SIZE_T Bytes = 0;
+	};
+
+	// 对象本身大小加上Exclusive模式下统计的容器分配
+	static SIZE_T GetObjectBytes(UObject* Object)
+	{
+		return Object->GetClass()->GetStructureSize() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	static void DumpClassStats(const TCHAR* Title, TMap<const UClass*, FClassMemoryStat>& Stats, FOutputDevice& Ar)
+	{
+		Stats.ValueSort([](const FClassMemoryStat& LHS, const FClassMemoryStat& RHS) { return LHS.Bytes > RHS.Bytes; });
+
+		FClassMemoryStat Total;
+		Ar.Logf(TEXT("---- %s ----"), Title);
+		for (const TPair<const UClass*, FClassMemoryStat>& Pair : Stats)
+		{
+			const FClassMemoryStat& Stat = Pair.Value;
+			Ar.Logf(TEXT("%-64s Num: %6d Bytes: %10llu Avg: %8llu"), *Pair.Key->GetName(), Stat.Num, (uint64)Stat.Bytes, (uint64)(Stat.Bytes / Stat.Num));
+			Total.Num += Stat.Num;
+			Total.Bytes += Stat.Bytes;
+		}
+		Ar.Logf(TEXT("%-64s Num: %6d Bytes: %10llu"), TEXT("Total"), Total.Num, (uint64)Total.Bytes);
+	}
+
+	static void Run(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		TMap<const UClass*, FClassMemoryStat> DispatcherStats;
+		int32 ExtraStateNum = 0;
+		for (TObjectIterator<UXD_ActionDispatcherBase> It; It; ++It)
+		{
+			UXD_ActionDispatcherBase* Dispatcher = *It;
+			if (Dispatcher->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject) || Dispatcher->GetWorld() != World)
+			{
+				continue;
+			}
+			FClassMemoryStat& Stat = DispatcherStats.FindOrAdd(Dispatcher->GetClass());
+			Stat.Num += 1;
+			Stat.Bytes += GetObjectBytes(Dispatcher);
+			ExtraStateNum += Dispatcher->GetExtraState() ? 1 : 0;
+		}
+
+		TMap<const UClass*, FClassMemoryStat> ActionStats;
+		for (TObjectIterator<UXD_DispatchableActionBase> It; It; ++It)
+		{
+			UXD_DispatchableActionBase* Action = *It;
+			if (Action->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject) || Action->GetWorld() != World)
+			{
+				continue;
+			}
+			FClassMemoryStat& Stat = ActionStats.FindOrAdd(Action->GetClass());
+			Stat.Num += 1;
+			Stat.Bytes += GetObjectBytes(Action);
+		}
+
+		Ar.Logf(TEXT("ActionDispatcher memory report for %s"), *World->GetName());
+		AGameStateBase* GameState = World->GetGameState();
+		if (UXD_ActionDispatcherManager* Manager = GameState ? GameState->FindComponentByClass<UXD_ActionDispatcherManager>() : nullptr)
+		{
+			Ar.Logf(TEXT("Actived: %d Pending: %d"), Manager->ActivedDispatchers.Num(), Manager->GetPendingDispatcherNum());
+		}
+		Ar.Logf(TEXT("Dispatchers with extra state: %d"), ExtraStateNum);
+		DumpClassStats(TEXT("Dispatchers"), DispatcherStats, Ar);
+		DumpClassStats(TEXT("Actions"), ActionStats, Ar);
+	}
+};
+
+namespace ActionDispatcherEditorDebug
+{
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice NodeIndexCheckCommand(
+		TEXT("ActionDispatcher.CheckNodeIndices"),
+		TEXT("ActionDispatcher.CheckNodeIndices [Path] 检查父子调度器蓝图的节点序号是否冲突"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&FActionDispatcherNodeIndexCheck::Run));
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice LinkCheckerCommand(
+		TEXT("ActionDispatcher.BenchmarkLinkChecker"),
+		TEXT("ActionDispatcher.BenchmarkLinkChecker [NodeNum] 测试调度图完成节点检查的耗时"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&FLinkToFinishNodeCheckerBenchmark::Run));
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice BookkeepingCommand(
+		TEXT("ActionDispatcher.BenchmarkBookkeeping"),
+		TEXT("ActionDispatcher.BenchmarkBookkeeping [Num] 测试管理器激活列表与等待队列的增删耗时"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&FActionDispatcherManagerBenchmark::Run));
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice DumpMemoryCommand(
+		TEXT("ActionDispatcher.DumpMemory"),
+		TEXT("按类统计当前世界中行为调度器与行为的内存占用"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&FActionDispatcherMemoryReport::Run));
+}
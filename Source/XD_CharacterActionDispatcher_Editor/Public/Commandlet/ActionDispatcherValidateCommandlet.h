@@ -0,0 +1,22 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <Commandlets/Commandlet.h>
+#include "ActionDispatcherValidateCommandlet.generated.h"
+
+/**
+ * 批量检查所有行为调度器蓝图，不进行完整的蓝图编译
+ * 资源在主线程分批加载，变量标记与结束节点检查在工作线程并行执行，结果输出为Json报告
+ * 用法：-run=ActionDispatcherValidate [-Path=/Game] [-Report=文件路径] [-BatchSize=256]
+ */
+UCLASS()
+class XD_CHARACTERACTIONDISPATCHER_EDITOR_API UActionDispatcherValidateCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	UActionDispatcherValidateCommandlet();
+
+	int32 Main(const FString& Params) override;
+};
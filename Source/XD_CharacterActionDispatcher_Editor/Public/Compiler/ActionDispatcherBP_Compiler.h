@@ -4,8 +4,10 @@
 
 #include "CoreMinimal.h"
 #include <KismetCompiler.h>
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
 
 class UActionDispatcherBlueprint;
+class UK2Node_Event;
 class FCompilerResultsLog;
 struct FKismetCompilerOptions;
 
@@ -28,4 +30,28 @@ public:
 	// End FKismetCompilerContext
 
 	UActionDispatcherBlueprint* ActionDispatcherBlueprint;
+
+	// 非行为调度器蓝图返回空
+	static FActionDispatcherBP_Compiler* Get(FKismetCompilerContext& CompilerContext);
+
+	// 检查暴露变量的SaveGame与ExposeOnSpawn标记，bAutoFix为false时只报错不修改蓝图
+	static void ValidateVariables(UBlueprint* Blueprint, FCompilerResultsLog& MessageLog, bool bAutoFix);
+	static UK2Node_Event* FindWhenDispatchStartNode(UActionDispatcherBlueprint* Blueprint);
+	// 检查编译后的节点序号，子类节点的序号需在父类节点之后且同类型序号不重复，只读取生成类
+	static void ValidateNodeIndices(const UActionDispatcherGeneratedClass* GeneratedClass, FCompilerResultsLog& MessageLog);
+
+	// 节点展开时注册需要运行时状态的节点，返回同类型节点中的序号
+	int32 RegisterDispatcherNode(const UEdGraphNode* Node, EActionDispatcherNodeType NodeType, int32 TogetherCount = 0);
+
+	// 展开节点与源节点NodeGuid一致，以此查找预编译时生成的原生状态
+	int32 FindNativeState(const UEdGraphNode* Node) const;
+private:
+	TMap<const UEdGraphNode*, int32> RegisteredNodes;
+	TArray<FActionDispatcherNodeData> CompiledNodeDatas;
+	int32 CompiledNodeNums[3] = {};
+	// 上次编译时各节点的序号，存档按序号保存节点状态，重新编译时沿用
+	TMap<FGuid, int32> PreviousNodeIndices[3];
+
+	TArray<FActionDispatcherNativeState> NativeStates;
+	TMap<FGuid, int32> NativeNodeStates;
 };
@@ -0,0 +1,38 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/ActionDispatcherGeneratedClass.h"
+
+class FActionDispatcherBP_Compiler;
+class UEdGraphNode;
+class UEdGraphPin;
+class UBpNode_ExecuteAction;
+
+/**
+ * 预编译时将调度图中可静态确定的部分生成为原生状态表
+ * 行为的事件只能跳转至状态表中的节点，否则该节点退回蓝图虚拟机执行
+ */
+class FActionDispatcherNativeTableBuilder
+{
+public:
+	FActionDispatcherNativeTableBuilder(FActionDispatcherBP_Compiler& Compiler);
+
+	void Build(const TSet<UEdGraphNode*>& VisitedNodes, TArray<FActionDispatcherNativeState>& OutStates, TMap<FGuid, int32>& OutNodeStates);
+private:
+	FActionDispatcherBP_Compiler& Compiler;
+
+	TSet<UEdGraphNode*> NativeNodes;
+	// 共同事件为首个输入的状态
+	TMap<const UEdGraphNode*, int32> NodeStates;
+
+	bool CanCompileNode(UEdGraphNode* Node) const;
+	bool CanCompileExecuteAction(UBpNode_ExecuteAction* Node) const;
+	// 输出引脚全部连接至状态表中的节点
+	bool IsNodeClosed(UEdGraphNode* Node) const;
+	bool IsNativeTargetPin(UEdGraphPin* OutputPin) const;
+
+	int32 GetTargetState(UEdGraphPin* OutputPin) const;
+	void AddExecuteActionState(UBpNode_ExecuteAction* Node, TArray<FActionDispatcherNativeState>& OutStates) const;
+};
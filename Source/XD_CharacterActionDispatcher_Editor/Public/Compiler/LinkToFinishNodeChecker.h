@@ -5,9 +5,28 @@
 #include "CoreMinimal.h"
 
 class FCompilerResultsLog;
+class UEdGraph;
 class UEdGraphNode;
+class UEdGraphPin;
+class UK2Node_Tunnel;
 class UK2Node_MacroInstance;
 
+// 同一次检查中共享的图索引与分析结果
+struct FNodeLinkCheckerCache
+{
+	// 宏图表的输入与输出Tunnel
+	TMap<const UEdGraph*, TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>> MacroTunnels;
+	// 节点的执行输出引脚
+	TMap<const UEdGraphNode*, TArray<UEdGraphPin*>> ExecOutputPins;
+	// 以该节点出发不会执行[结束调度器]的节点
+	TSet<const UEdGraphNode*> NoFinishNodes;
+	// 等待检查不可连接[结束调度器]的引脚，检查过程中可继续添加
+	TArray<UEdGraphPin*> ForceNotConnectPins;
+
+	const TPair<UK2Node_Tunnel*, UK2Node_Tunnel*>& GetMacroTunnels(const UEdGraph* MacroGraph);
+	const TArray<UEdGraphPin*>& GetExecOutputPins(const UEdGraphNode* Node);
+};
+
 struct FNodeLinkCheckerBase
 {
 public:
@@ -16,30 +35,58 @@ public:
 	FNodeLinkCheckerBase(){}
 	virtual ~FNodeLinkCheckerBase(){}
 protected:
-	bool CheckNextNode(UEdGraphNode* Node);
+	// 节点加入待检查队列，MacroFrame为经过的宏实例
+	void CheckNextNode(UEdGraphNode* Node, int32 MacroFrame = INDEX_NONE);
+	// 处理待检查队列，ExecuteCheck返回true时停止并返回true
+	bool RunCheck();
 	virtual bool ExecuteCheck(UEdGraphNode* Node) = 0;
 
-	void ConvertRetargetPin(UEdGraphPin*& Pin, bool& bShowErrorOnLinkedPin);
-	//Key为结束的Tunnel节点
-	TMap<UK2Node_Tunnel*, UK2Node_MacroInstance*> MacroNodeLinkers;
+	// 跳过宏与合并节点的中转，返回转换后引脚所在的宏实例
+	int32 ConvertRetargetPin(UEdGraphPin*& Pin, bool& bShowErrorOnLinkedPin);
+	const TArray<UEdGraphPin*>& GetExecOutputPins(const UEdGraphNode* Node);
+
+	// 为空时使用检查器自身的索引
+	FNodeLinkCheckerCache* Cache = nullptr;
+	FNodeLinkCheckerCache& GetCache() { return Cache ? *Cache : LocalCache; }
+	// 当前检查的节点所在的宏实例
+	int32 CurrentMacroFrame = INDEX_NONE;
+private:
+	struct FMacroFrame
+	{
+		UK2Node_MacroInstance* MacroInstance;
+		int32 ParentFrame;
+	};
+	TArray<FMacroFrame> MacroFrames;
+
+	struct FPendingNode
+	{
+		UEdGraphNode* Node;
+		int32 MacroFrame;
+	};
+	TArray<FPendingNode> PendingNodes;
+
+	FNodeLinkCheckerCache LocalCache;
 };
 
 struct FLinkToFinishNodeChecker : public FNodeLinkCheckerBase
 {
 public:
 	static FLinkToFinishNodeChecker CheckForceConnectFinishNode(UEdGraphNode* Node, FCompilerResultsLog& MessageLog);
-	static void CheckForceNotConnectFinishNode(UEdGraphPin* Pin, FCompilerResultsLog& MessageLog);
+	// 检查在当前检查结束后执行，共享当前检查的结果
+	void CheckForceNotConnectFinishNode(UEdGraphPin* Pin);
 
 	void CheckPinConnectedFinishNode(UEdGraphPin* Pin);
 	FCompilerResultsLog& MessageLog;
 private:
 	FLinkToFinishNodeChecker(FCompilerResultsLog& MessageLog, bool bForceNotConnectFinishedNode)
-		:MessageLog(MessageLog), bForceNotConnectFinishedNode(bForceNotConnectFinishedNode)
+		:MessageLog(MessageLog), bForceNotConnectFinishedNode(bForceNotConnectFinishedNode), bCanCacheResult(true), StartSearchPin(nullptr)
 	{}
 
 	uint8 bForceNotConnectFinishedNode : 1;
+	// 检查结果与宏实例或起始节点无关时，访问过的节点可记录为不会执行[结束调度器]
+	uint8 bCanCacheResult : 1;
 	UEdGraphPin* StartSearchPin;
 
+	void RunForceNotConnectCheck(UEdGraphPin* Pin);
 	bool ExecuteCheck(UEdGraphNode* Node) override;
 };
-
@@ -30,8 +30,9 @@ public:
 protected:
 	UClass* GetClassPinBaseClass() const override;
 
+	// 软引用，只在展开节点时加载，旧资源中的硬引用由属性序列化自动转换
 	UPROPERTY()
-	TSubclassOf<UXD_ActionDispatcherBase> ActionDispatcherClass;
+	TSoftClassPtr<UXD_ActionDispatcherBase> ActionDispatcherClass;
 
 	UPROPERTY()
 	TArray<FName> FinishedTags;
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "K2Node.h"
+#include <GameplayTagContainer.h>
 #include "BpNode_CheckStateTag.generated.h"
 
 /**
@@ -24,6 +25,11 @@ public:
 	bool CanDuplicateNode() const override { return false; }
 	void PostPlacedNewNode() override;
 	void PinConnectionListChanged(UEdGraphPin* Pin) override;
+	bool ShouldShowNodeProperties() const override { return true; }
+
+	// 不为空时以该查询代替Tag引脚判断，多个Tag编译为一次求值，[增加Tag]仍使用Tag引脚
+	UPROPERTY(EditAnywhere, Category = "检查", meta = (DisplayName = "Tag查询"))
+	FGameplayTagQuery TagQuery;
 protected:
 	friend class UBpNode_AddStateTag;
 	static FName TagExistPinName;
@@ -43,6 +43,10 @@ class XD_CHARACTERACTIONDISPATCHER_EDITOR_API UBpNode_AD_CreateObjectBase : publ
 	/** Create new pins to show properties on archetype */
 	void CreatePinsForClass(UClass* InClass, TArray<UEdGraphPin*>* OutClassPins = nullptr);
 
+	// 暴露属性布局的缓存在类重新实例化或修改默认值时清除，由模块启动与关闭时调用
+	static void RegisterPinLayoutCache();
+	static void UnregisterPinLayoutCache();
+
 	/** See if this is a spawn variable pin, or a 'default' pin */
 	virtual bool IsSpawnVarPin(UEdGraphPin* Pin) const;
 
@@ -115,11 +119,13 @@ public:
 	TSubclassOf<UXD_DispatchableActionBase> ActionClass;
 
 protected:
-	FString GetActionGuidValue() const;
 	FString GetSaveActionValue() const;
+	// 向编译器注册行为节点，返回行为序号，不需要保存的行为返回INDEX_NONE
+	int32 RegisterActionNode(FKismetCompilerContext& CompilerContext) const;
+	FString GetActionIndexValue(FKismetCompilerContext& CompilerContext) const;
 
-	UEdGraphPin* CreateInvokeActiveActionNode(UEdGraphPin* LastThen, UK2Node_CallFunction* GetMainActionDispatcherNode, UEdGraphPin* ActionRefPin, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
-	void LinkResultPin(UK2Node_CallFunction* GetMainActionDispatcherNode, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
+	UEdGraphPin* CreateInvokeActiveActionNode(UEdGraphPin* LastThen, UEdGraphPin* ActionRefPin, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
+	void LinkResultPin(FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
 
 	void CreateActionEventPins(const TSubclassOf<UXD_DispatchableActionBase>& InActionClass);
 	UEdGraphPin* CreateAllEventNode(UEdGraphPin* LastThen, UEdGraphPin* ActionRefPin, const FName& EntryPointEventName, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
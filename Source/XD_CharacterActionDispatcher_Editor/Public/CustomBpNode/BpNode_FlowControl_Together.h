@@ -27,6 +27,23 @@ public:
 	void AllocateDefaultPins() override;
 	void ExpandNode(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph) override;
 
+	bool ShouldShowNodeProperties() const override { return true; }
+	void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+
+	// 到达数量满足后触发，为0时需全部输入到达
+	UPROPERTY(EditAnywhere, Category = "共同事件", meta = (DisplayName = "需到达数量", ClampMin = "0"))
+	int32 RequiredCount = 0;
+
+	// 首个输入到达后开始计时，超时后直接触发，为0时不超时
+	UPROPERTY(EditAnywhere, Category = "共同事件", meta = (DisplayName = "超时时间", ClampMin = "0"))
+	float Timeout = 0.f;
+
+	int32 GetTogetherEventCount() const { return TogetherEventCount; }
+	UEdGraphPin* GetTogetherEventPin() const;
+	UEdGraphPin* GetWaitPin(int32 Idx) const;
+	// 输入引脚的序号，非输入引脚返回INDEX_NONE
+	int32 GetExecPinIndex(const UEdGraphPin* Pin) const;
+
 protected:
 	void WhenCheckLinkedFinishNode(FLinkToFinishNodeChecker& Checker) const override;
 
@@ -39,8 +56,8 @@ private:
 
 	void RemoveExecPin(const UEdGraphPin* Pin);
 
-	FName GetExecPinName(int32 Idx);
-	FName GetWaitPinName(int32 Idx);
+	static FName GetExecPinName(int32 Idx);
+	static FName GetWaitPinName(int32 Idx);
 
 	TMap<UEdGraphPin*, UEdGraphPin*> TogetherPins;
 };
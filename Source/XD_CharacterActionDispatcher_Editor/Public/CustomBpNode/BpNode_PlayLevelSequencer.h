@@ -49,6 +49,27 @@ public:
 	bool IsPositionValid() const { return Location != InvalidLocation && Rotation != InvalidRotation; }
 };
 
+// Sequence保存时写入资源注册表的可绑定对象摘要，节点刷新时无需加载Sequence
+USTRUCT()
+struct FSequencerBindingSummary
+{
+	GENERATED_BODY()
+public:
+	// 摘要内容变化时增加，旧版本的标签视为不存在
+	static constexpr int32 CurrentVersion = 1;
+
+	UPROPERTY()
+	int32 Version = 0;
+
+	UPROPERTY()
+	TArray<FSequencerBindingOption> BindingOptions;
+
+	static FName GetRegistryName() { return TEXT("ActionDispatcherSequenceBindings"); }
+	static void Build(const ULevelSequence* LevelSequence, TArray<FSequencerBindingOption>& OutBindingOptions);
+	FString ExportToString() const;
+	bool ImportFromString(const FString& Value);
+};
+
 struct FSequencerBindingOption_Customization : public IPropertyTypeCustomization
 {
 	static TSharedRef<IPropertyTypeCustomization> MakeInstance()
@@ -96,6 +117,15 @@ private:
 	UFUNCTION(Category = "Sequence", meta = (DisplayName = "刷新Sequence数据", CallInEditor = true))
 	void RefreshSequenceData();
 
+	// 优先读取资源注册表中的摘要，不存在时异步加载Sequence，加载期间保留原有的绑定
+	void ApplyBindingOptions(TArray<FSequencerBindingOption>&& NewBindingOptions);
+	void WhenSequenceLoaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result, FSoftObjectPath RequestSequencePath);
+	uint8 bIsLoadingSequenceData : 1;
+public:
+	// Sequence保存时写入可绑定对象摘要，由模块启动与关闭时调用
+	static void RegisterSequenceBindingTags();
+	static void UnregisterSequenceBindingTags();
+
 public:
 	UPROPERTY(EditAnywhere, Category = "调试")
 	FName EntryPointEventName;
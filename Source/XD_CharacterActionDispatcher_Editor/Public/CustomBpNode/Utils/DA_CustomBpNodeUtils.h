@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include <UObject/SoftObjectPtr.h>
 
 class UBlueprint;
 class UEdGraphNode;
@@ -10,8 +11,12 @@ class FKismetCompilerContext;
 class UEdGraphPin;
 class UEdGraph;
 class UK2Node;
+class UK2Node_CallFunction;
+class FProperty;
 struct FGraphNodeContextMenuBuilder;
 class UXD_DispatchableActionBase;
+class UXD_ActionDispatcherBase;
+enum class EActionDispatcherNodeType : uint8;
 
 /**
  * 
@@ -52,6 +57,20 @@ struct DA_NodeUtils
 	static UEdGraphPin* CreateFinishEventPin(UK2Node* EdNode, const FName& PinName, const FText& DisplayName = FText::GetEmpty());
 	static UEdGraphPin* CreateNormalEventPin(UK2Node* EdNode, const FName& PinName, const FText& DisplayName = FText::GetEmpty());
 
+	// 向行为调度器编译器注册需要运行时状态的节点，返回同类型节点中的序号，非行为调度器蓝图报错并返回INDEX_NONE
+	static int32 RegisterDispatcherNode(const UEdGraphNode* Node, FKismetCompilerContext& CompilerContext, EActionDispatcherNodeType NodeType, int32 TogetherCount = 0);
+
+	// 节点在原生状态表中的状态序号，未编译进状态表返回INDEX_NONE
+	static int32 FindNativeState(const UEdGraphNode* Node, FKismetCompilerContext& CompilerContext);
+	// 节点已编译进原生状态表时创建EnterNativeState调用并转移执行引脚，否则返回空
+	static UK2Node_CallFunction* ExpandNativeStateEntry(UK2Node* Node, FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph);
+
+	// 未连接的引脚默认值与类默认对象中的值相同时无需赋值
+	static bool IsPinDefaultValueMatchClass(FKismetCompilerContext& CompilerContext, const UEdGraphPin* Pin, const UClass* ForClass, FProperty* Property);
+
+	// 调度器的所有结束事件Tag，按软路径读取资源注册表，旧资源未记录时只访问已加载类的默认对象
+	static TArray<FName> GetDispatcherFinishTags(const TSoftClassPtr<UXD_ActionDispatcherBase>& DispatcherClass);
+
 	// 从FKismetCompilerUtilities::GenerateAssignmentNodes拷贝，增加了对Property的元数据MD_ExposeOnSpawn的检查
 	static UEdGraphPin* GenerateAssignmentNodes(class FKismetCompilerContext& CompilerContext, UEdGraph* SourceGraph, UK2Node_CallFunction* CallBeginSpawnNode, UEdGraphNode* SpawnNode, UEdGraphPin* CallBeginResult, const UClass* ForClass);
 
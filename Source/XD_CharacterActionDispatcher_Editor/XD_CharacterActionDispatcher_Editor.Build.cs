@@ -53,6 +53,8 @@ public class XD_CharacterActionDispatcher_Editor : ModuleRules
                 "LevelSequence",
                 "GameplayTags",
                 "ToolMenus",
+                "AssetRegistry",
+                "Json",
 
 				// ... add private dependencies that you statically link with here ...	
 